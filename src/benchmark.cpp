@@ -0,0 +1,562 @@
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+
+#include "cdga.h"
+#include "homology.h"
+#include "modular.h"
+#include "ranking.h"
+#include "enumeration.h"
+#include "grading.h"
+
+using namespace std;
+
+// *** Benchmarks of cdga-generators ***
+//
+// The program "cdga-benchmark" times the main steps of a computation on a set of models, so that the performance of
+// two versions of cdga-generators can be compared. The models are:
+// (1) The input files of a directory (by default "examples", which holds the five examples of README.md). Each file is
+// read like cdga-generators reads it, and its degree range and category are used.
+// (2) Two families of models of growing size n = 2, ..., max-size:
+//     "spheres": the product of n copies of S^2, with generators a_i in degree 2 and x_i in degree 3, d(x_i) = a_i^2.
+//     "sp-flag": the homogeneous space Sp(n)/Sp(1)^n (a biquotient of Sp(n)), with generators a_i in degree 4 and y_k in
+//     degree 4k-1, where d(y_k) is the k-th elementary symmetric polynomial in a_1, ..., a_n.
+// The range of a family model goes from degree 2 to the top class of the space.
+//
+// For each model, the micro-benchmarks time the following steps in the degree n of the range whose basis is the largest:
+//   enumerate      Enumerate the basis of degree n with a BasisIterator
+//   evaluate       Evaluate the differential on every word of the basis (EvaluateDifferential, starting from an empty cache)
+//   matrix         Compute the matrix of d_n (ComputeDifferentialMatrix, starting from an empty cache)
+//   coordinates    Find the coordinates of the differentials of the words of the basis (GetCoordinates)
+//   cocycles       Find a basis of cocycles (FindCocycleBasis)
+//   homology       Find a basis of the homology from the reductions of d_{n-1} and d_n (FindHomologyBasis)
+// and the end-to-end benchmarks time the computation over the whole range:
+//   extension      A basis of cocycles for the homology in every degree, as "compute = extension" does
+//   betti          The dimension of the homology in every degree, as "compute = betti" does
+//
+// Every benchmark is run several times and both the fastest and the mean time are reported. The "count" of a result is
+// the amount of work done by the benchmark (words, non-zero entries, cocycles, ...), which must not change from one
+// version to the next: a different count means a different computation, and the times can't be compared.
+//
+// USAGE: cdga-benchmark [-o results.json] [-examples directory] [-repeat n] [-max-size n] [-filter text] [-label text]
+//   -o         The file receiving the results (default "benchmark.json"). A name ending in ".csv" gives a CSV file,
+//              any other name a JSON file.
+//   -examples  The directory of the input files (default "examples")
+//   -repeat    The number of runs of each benchmark (default 3)
+//   -max-size  The largest size of the models of the families (default 5)
+//   -filter    Only run the benchmarks whose name or model contains this text
+//   -label     A label stored with the results, for example the version of the program
+
+struct BenchmarkOptions
+{
+	BenchmarkOptions();
+
+	string output_filename;
+	string examples_directory;
+	int repeat;
+	int max_size;
+	string filter;
+	string label;
+};
+
+BenchmarkOptions::BenchmarkOptions()
+{
+	output_filename = "benchmark.json";
+	examples_directory = "examples";
+	repeat = 3;
+	max_size = 5;
+}
+
+struct BenchmarkResult
+{
+	string name;
+	string model;
+	int degree;
+	int runs;
+	double best_ms;
+	double mean_ms;
+	long long count;
+};
+
+// A model together with the degree range of its computation
+struct BenchmarkModel
+{
+	BenchmarkModel();
+
+	string name;
+	FreeCGA cdga;
+	Differential diff;
+	int degree_start;
+	int degree_end;
+	int category;
+	// As in the "Output:" section of an input file
+	bool detect_grading;
+	int threads;
+};
+
+BenchmarkModel::BenchmarkModel()
+{
+	OutputOptions options;
+	degree_start = 2;
+	degree_end = 2;
+	category = -1;
+	detect_grading = options.detect_grading;
+	threads = options.threads;
+}
+
+// Measures the time spent between Start and Stop, so that a benchmark can prepare its data outside of the measure
+class Stopwatch
+{
+public:
+	Stopwatch() : elapsed(0) {}
+
+	void Start() { begin = chrono::steady_clock::now(); }
+	void Stop() { elapsed += chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count(); }
+	double GetMilliseconds() const { return elapsed; }
+
+private:
+	chrono::steady_clock::time_point begin;
+	double elapsed;
+};
+
+static vector<BenchmarkResult> results;
+
+// Run a benchmark "options.repeat" times and record its times. The benchmark returns its count.
+static void Measure(const BenchmarkOptions &options, const string &name, const BenchmarkModel &model, int degree, const function<long long (Stopwatch &)> &benchmark)
+{
+	if (!options.filter.empty() && name.find(options.filter) == string::npos && model.name.find(options.filter) == string::npos) {
+		return;
+	}
+
+	BenchmarkResult result;
+	result.name = name;
+	result.model = model.name;
+	result.degree = degree;
+	result.runs = max(options.repeat, 1);
+	result.best_ms = 0;
+	result.mean_ms = 0;
+	result.count = 0;
+	for (int i=0; i<result.runs; i++) {
+		Stopwatch clock;
+		result.count = benchmark(clock);
+		double ms = clock.GetMilliseconds();
+		if (i == 0 || ms < result.best_ms)
+			result.best_ms = ms;
+		result.mean_ms += ms / result.runs;
+	}
+	cout << setw(12) << left << name << setw(20) << model.name << right << setw(4) << degree << fixed << setprecision(3)
+		<< setw(14) << result.best_ms << " ms" << setw(14) << result.mean_ms << " ms" << setw(12) << result.count << endl;
+	cout.unsetf(ios::floatfield);
+	results.push_back(result);
+}
+
+// Compute a basis of the homology in every degree of the range with the rolling window of cdga-generators (see
+// HomologyWindow in homology.h), and return the sum of the dimensions. Like cdga-generators, the matrices are split
+// into blocks when the differential respects an extra grading.
+static long long ComputeHomology(BenchmarkModel &model)
+{
+	ExtraGrading grading;
+	if (model.detect_grading) {
+		grading.Detect(model.cdga, model.diff);
+	}
+
+	HomologyWindow window(model.cdga, model.diff, model.category+1, grading, model.threads);
+	window.Start(model.degree_start);
+	long long total = 0;
+	for (int degree = model.degree_start; degree <= model.degree_end; degree++) {
+		OrderedLCBasis cocycles_basis, image_basis;
+		window.Move(degree);
+		window.Reduce(cocycles_basis, image_basis);
+		total += (long long)cocycles_basis.size();
+	}
+	return total;
+}
+
+// Compute the dimension of the homology in every degree of the range like "compute = betti" does (see
+// ComputeHomologyDimensions in homology.h), and return the sum of the dimensions
+static long long ComputeBettiNumbers(BenchmarkModel &model)
+{
+	BasisRanker ranker(model.cdga, model.degree_end+1, model.category+1, true);
+	vector<long long> dimensions;
+	ComputeHomologyDimensions(model.cdga, model.diff, ranker, model.degree_start, model.degree_end, model.category+1, dimensions);
+
+	long long total = 0;
+	for (vector<long long>::const_iterator it = dimensions.begin(); it != dimensions.end(); it++) {
+		total += *it;
+	}
+	return total;
+}
+
+static void RunBenchmarks(const BenchmarkOptions &options, BenchmarkModel &model)
+{
+	FreeCGA &cdga = model.cdga;
+	Differential &diff = model.diff;
+	int minLength = model.category+1;
+
+	// The micro-benchmarks run in the degree of the range with the largest basis
+	int degree = model.degree_start;
+	size_t largest = 0;
+	for (int deg = model.degree_start; deg <= model.degree_end; deg++) {
+		OrderedBasis basis;
+		cdga.GetBasisInDegreeExtended(basis, deg, minLength);
+		if (basis.size() > largest) {
+			largest = basis.size();
+			degree = deg;
+		}
+	}
+
+	OrderedBasis previous, source, target;
+	cdga.GetBasisInDegreeExtended(previous, degree-1, minLength);
+	cdga.GetBasisInDegreeExtended(source, degree, minLength);
+	cdga.GetBasisInDegreeExtended(target, degree+1, minLength);
+	IndexedBasis indexed_source(source), indexed_target(target);
+
+	Measure(options, "enumerate", model, degree, [&](Stopwatch &clock) -> long long {
+		long long count = 0;
+		Word word;
+		clock.Start();
+		BasisIterator words(cdga, degree, minLength, true);
+		while (words.Next(word))
+			count++;
+		clock.Stop();
+		return count;
+	});
+
+	Measure(options, "evaluate", model, degree, [&](Stopwatch &clock) -> long long {
+		long long count = 0;
+		LinearCombination lc;
+		diff.ClearCache();
+		clock.Start();
+		for (size_t i=0; i<source.size(); i++) {
+			diff.EvaluateDifferential(lc, source[i]);
+			count++;
+		}
+		clock.Stop();
+		return count;
+	});
+
+	// The matrices of d_{n-1} and d_n are kept for the benchmarks of the linear algebra
+	SparseMatrix matrix_prev(0, (long long)previous.size()), matrix(0, (long long)source.size());
+	Measure(options, "matrix", model, degree, [&](Stopwatch &clock) -> long long {
+		diff.ClearCache();
+		clock.Start();
+		if (!source.empty() && !target.empty())
+			diff.ComputeDifferentialMatrix(matrix, source, indexed_target);
+		clock.Stop();
+		return matrix.GetNonZeros();
+	});
+	if (!previous.empty() && !source.empty())
+		diff.ComputeDifferentialMatrix(matrix_prev, previous, indexed_source);
+
+	vector<LinearCombination> differentials(source.size());
+	for (size_t i=0; i<source.size(); i++) {
+		diff.EvaluateDifferential(differentials[i], source[i]);
+	}
+	Measure(options, "coordinates", model, degree, [&](Stopwatch &clock) -> long long {
+		long long count = 0;
+		CoefficientVector coordinates;
+		clock.Start();
+		for (size_t i=0; i<differentials.size(); i++) {
+			differentials[i].GetCoordinates(coordinates, indexed_target);
+			count += (long long)coordinates.size();
+		}
+		clock.Stop();
+		return count;
+	});
+
+	Measure(options, "cocycles", model, degree, [&](Stopwatch &clock) -> long long {
+		OrderedLCBasis cocycles;
+		clock.Start();
+		if (!source.empty())
+			FindCocycleBasis(matrix, cocycles, source);
+		clock.Stop();
+		return (long long)cocycles.size();
+	});
+
+	Measure(options, "homology", model, degree, [&](Stopwatch &clock) -> long long {
+		ReducedDifferential reduced_prev, reduced;
+		OrderedLCBasis homology, image;
+		if (!previous.empty())
+			ReduceDifferential(matrix_prev, reduced_prev, previous);
+		if (!source.empty())
+			ReduceDifferential(matrix, reduced, source);
+		clock.Start();
+		if (!source.empty())
+			FindHomologyBasis(reduced_prev, reduced, homology, image, source);
+		clock.Stop();
+		return (long long)homology.size();
+	});
+
+	int degree_range = model.degree_end;
+	Measure(options, "extension", model, degree_range, [&](Stopwatch &clock) -> long long {
+		diff.ClearCache();
+		clock.Start();
+		long long count = ComputeHomology(model);
+		clock.Stop();
+		return count;
+	});
+
+	Measure(options, "betti", model, degree_range, [&](Stopwatch &clock) -> long long {
+		diff.ClearCache();
+		clock.Start();
+		long long count = ComputeBettiNumbers(model);
+		clock.Stop();
+		return count;
+	});
+	diff.ClearCache();
+}
+
+// Define the differential of a generator of a model from its text form (see operator>> for LinearCombination)
+static void SetDifferential(BenchmarkModel &model, const string &label, const string &value)
+{
+	LinearCombination lc(&model.cdga.GetGeneratorRegistry());
+	stringstream ss(value);
+	if (!(ss >> lc)) {
+		throw logic_error("The differential of '" + label + "' can't be read.");
+	}
+	model.diff.SetDifferential(label, lc);
+}
+
+// Return the label "prefix_i"
+static string Label(const string &prefix, int i)
+{
+	stringstream ss;
+	ss << prefix << "_" << i;
+	return ss.str();
+}
+
+// The product of n copies of S^2
+static void BuildSphereProduct(BenchmarkModel &model, int n)
+{
+	model.name = Label("spheres", n);
+	model.diff.SetGeneratorRegistry(model.cdga.GetGeneratorRegistry());
+	for (int i=1; i<=n; i++) {
+		model.cdga.AddGenerator(Label("a", i), 2);
+		model.cdga.AddGenerator(Label("x", i), 3);
+	}
+	for (int i=1; i<=n; i++) {
+		SetDifferential(model, Label("a", i), "0");
+		SetDifferential(model, Label("x", i), Label("a", i) + "^2");
+	}
+	model.degree_start = 2;
+	model.degree_end = 2*n;
+	model.category = -1;
+}
+
+// Append the k-th elementary symmetric polynomial in the generators a_first, ..., a_n to "sum", as a sum of words
+static void AppendElementarySymmetric(string &sum, string &word, int first, int n, int k)
+{
+	if (k == 0) {
+		sum += (sum.empty() ? "" : " + ") + word;
+		return;
+	}
+	for (int i=first; i<=n-k+1; i++) {
+		string factor = Label("a", i);
+		size_t size = word.size();
+		word += (word.empty() ? "" : " * ") + factor;
+		AppendElementarySymmetric(sum, word, i+1, n, k-1);
+		word.resize(size);
+	}
+}
+
+// The homogeneous space Sp(n)/Sp(1)^n. Its dimension is dim Sp(n) - 3n = 2n^2 - 2n.
+static void BuildSymplecticFlag(BenchmarkModel &model, int n)
+{
+	model.name = Label("sp-flag", n);
+	model.diff.SetGeneratorRegistry(model.cdga.GetGeneratorRegistry());
+	for (int i=1; i<=n; i++) {
+		model.cdga.AddGenerator(Label("a", i), 4);
+	}
+	for (int k=1; k<=n; k++) {
+		model.cdga.AddGenerator(Label("y", k), 4*k-1);
+	}
+	for (int i=1; i<=n; i++) {
+		SetDifferential(model, Label("a", i), "0");
+	}
+	for (int k=1; k<=n; k++) {
+		string sum, word;
+		AppendElementarySymmetric(sum, word, 1, n, k);
+		SetDifferential(model, Label("y", k), sum);
+	}
+	model.degree_start = 2;
+	model.degree_end = 2*n*n - 2*n;
+	model.category = -1;
+}
+
+// Read one of the example files. Return false if it can't be read.
+static bool ReadExample(BenchmarkModel &model, const string &directory, const string &filename)
+{
+	OutputOptions options;
+	if (!ReadInputFromFile(directory + "/" + filename, model.cdga, model.diff, options)) {
+		return false;
+	}
+	model.name = filename.substr(0, filename.find_last_of("."));
+	model.degree_start = max(options.homology_degree_start, 2);
+	model.degree_end = max(options.homology_degree_end, model.degree_start);
+	model.category = options.category;
+	model.detect_grading = options.detect_grading;
+	model.threads = options.threads;
+	return true;
+}
+
+// Return a string as a JSON string, with its quotes. The label and the names of the files are given by the user, so
+// they may contain quotes, backslashes or control characters.
+static string QuoteJSON(const string &text)
+{
+	ostringstream quoted;
+	quoted << '"';
+	for (string::const_iterator it = text.begin(); it != text.end(); it++) {
+		unsigned char c = (unsigned char)*it;
+		if (c == '"' || c == '\\') {
+			quoted << '\\' << (char)c;
+		} else if (c == '\n') {
+			quoted << "\\n";
+		} else if (c == '\r') {
+			quoted << "\\r";
+		} else if (c == '\t') {
+			quoted << "\\t";
+		} else if (c < 0x20) {
+			quoted << "\\u" << hex << setw(4) << setfill('0') << (int)c << dec << setfill(' ');
+		} else {
+			quoted << (char)c;
+		}
+	}
+	quoted << '"';
+	return quoted.str();
+}
+
+// Return a field of a CSV file between quotes, with its quotes doubled (RFC 4180), so that a comma or a line break
+// doesn't split it
+static string QuoteCSV(const string &text)
+{
+	string quoted = "\"";
+	for (string::const_iterator it = text.begin(); it != text.end(); it++) {
+		if (*it == '"') {
+			quoted += '"';
+		}
+		quoted += *it;
+	}
+	quoted += '"';
+	return quoted;
+}
+
+static void WriteJSON(ostream &stream, const BenchmarkOptions &options)
+{
+	stream << "{" << endl;
+	stream << "  \"label\": " << QuoteJSON(options.label) << "," << endl;
+	stream << "  \"repeat\": " << options.repeat << "," << endl;
+	stream << "  \"results\": [" << endl;
+	for (size_t i=0; i<results.size(); i++) {
+		const BenchmarkResult &r = results[i];
+		stream << "    {\"name\": " << QuoteJSON(r.name) << ", \"model\": " << QuoteJSON(r.model) << ", \"degree\": "
+			<< r.degree << ", \"runs\": " << r.runs << fixed << setprecision(3) << ", \"best_ms\": " << r.best_ms << ", \"mean_ms\": "
+			<< r.mean_ms << ", \"count\": " << r.count << "}" << (i+1 < results.size() ? "," : "") << endl;
+		stream.unsetf(ios::floatfield);
+	}
+	stream << "  ]" << endl;
+	stream << "}" << endl;
+}
+
+static void WriteCSV(ostream &stream, const BenchmarkOptions &options)
+{
+	stream << "label,name,model,degree,runs,best_ms,mean_ms,count" << endl;
+	for (size_t i=0; i<results.size(); i++) {
+		const BenchmarkResult &r = results[i];
+		stream << QuoteCSV(options.label) << "," << QuoteCSV(r.name) << "," << QuoteCSV(r.model) << "," << r.degree << ","
+			<< r.runs << "," << fixed << setprecision(3) << r.best_ms << "," << r.mean_ms << "," << r.count << endl;
+		stream.unsetf(ios::floatfield);
+	}
+}
+
+// Return false if the command line can't be read
+static bool ReadOptions(BenchmarkOptions &options, int argc, char **argv)
+{
+	for (int i=1; i<argc; i++) {
+		string option = argv[i];
+		if (i+1 >= argc) {
+			cerr << "The option '" << option << "' needs a value." << endl;
+			return false;
+		}
+		string value = argv[++i];
+		stringstream ss(value);
+		if (option == "-o") {
+			options.output_filename = value;
+		} else if (option == "-examples") {
+			options.examples_directory = value;
+		} else if (option == "-repeat") {
+			if (!(ss >> options.repeat) || options.repeat < 1) {
+				cerr << "The number of runs is invalid." << endl;
+				return false;
+			}
+		} else if (option == "-max-size") {
+			if (!(ss >> options.max_size) || options.max_size < 2) {
+				cerr << "The largest size of the families is invalid." << endl;
+				return false;
+			}
+		} else if (option == "-filter") {
+			options.filter = value;
+		} else if (option == "-label") {
+			options.label = value;
+		} else {
+			cerr << "Unknown option '" << option << "'." << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	BenchmarkOptions options;
+	if (!ReadOptions(options, argc, argv)) {
+		cerr << "Usage: cdga-benchmark [-o results.json] [-examples directory] [-repeat n] [-max-size n] [-filter text] [-label text]" << endl;
+		return 1;
+	}
+
+	cout << setw(12) << left << "BENCHMARK" << setw(20) << "MODEL" << right << setw(4) << "DEG" << setw(17) << "BEST"
+		<< setw(17) << "MEAN" << setw(12) << "COUNT" << endl;
+	try {
+		const char *examples[] = { "example1.txt", "example2.txt", "example3.txt", "example4.txt", "example5.txt" };
+		for (int i=0; i<5; i++) {
+			BenchmarkModel model;
+			if (ReadExample(model, options.examples_directory, examples[i])) {
+				RunBenchmarks(options, model);
+			} else {
+				cerr << "Skipping the example '" << examples[i] << "'." << endl;
+			}
+		}
+		for (int n=2; n<=options.max_size; n++) {
+			BenchmarkModel model;
+			BuildSphereProduct(model, n);
+			RunBenchmarks(options, model);
+		}
+		for (int n=2; n<=options.max_size; n++) {
+			BenchmarkModel model;
+			BuildSymplecticFlag(model, n);
+			RunBenchmarks(options, model);
+		}
+	} catch (exception &e) {
+		cerr << "An exception has occured: " << e.what() << endl;
+		return 1;
+	}
+
+	ofstream output(options.output_filename);
+	if (!output.is_open()) {
+		cerr << "Unable to open file '" << options.output_filename << "'." << endl;
+		return 1;
+	}
+	size_t pos = options.output_filename.find_last_of(".");
+	if (pos != string::npos && options.output_filename.substr(pos) == ".csv") {
+		WriteCSV(output, options);
+	} else {
+		WriteJSON(output, options);
+	}
+	cout << "The results were written to '" << options.output_filename << "'." << endl;
+	return 0;
+}
@@ -1,8 +1,17 @@
 #include "cdga.h"
+#include "ranking.h"
+#include "enumeration.h"
+#include "profile.h"
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <algorithm>
+#include <iterator>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <cstdio>
+#include <cstring>
 #include <assert.h>
 
 using namespace std;
@@ -28,40 +37,142 @@ int nChoosek(int n, int k)
 	return factorial(n) / (factorial(k) * factorial(n-k));
 }
 
-void AddIndexedOrderedBasisElement(vector<OrderedBasis> &basis, Word word)
+void AddIndexedOrderedBasisElement(vector<vector<Generator> > &basis, const Generator &gen)
 {
 	// Make sure the array has been extended in the required degree
 	// If not, add space for 100 more degrees
-	if (word.GetDegree() >= (int)basis.size()) {
+	if (gen.degree >= (int)basis.size()) {
 		basis.resize(basis.size()+100);
 	}
-	basis[word.GetDegree()].push_back(word);
+	basis[gen.degree].push_back(gen);
 }
 
-void AddIndexedOrderedBasisElement(vector<vector<Generator> > &basis, Generator gen)
+GeneratorRegistry::GeneratorRegistry()
 {
-	// Make sure the array has been extended in the required degree
-	// If not, add space for 100 more degrees
-	if (gen.degree >= (int)basis.size()) {
-		basis.resize(basis.size()+100);
+}
+
+int GeneratorRegistry::Intern(const string &label, int degree)
+{
+	// Check if a generator with the same name already exists
+	if (ids.find(label) != ids.end()) {
+		throw logic_error("The generator with label '" + label +"' already exists.");
 	}
-	basis[gen.degree].push_back(gen);
+
+	int id = (int)generators.size();
+	Generator gen(label, degree);
+	gen.id = id;
+	gen.registry = this;
+	generators.push_back(gen);
+	degrees.push_back(degree);
+	even.push_back(isEven(degree) ? 1 : 0);
+	ids[label] = id;
+
+	if (isEven(degree)) {
+		slots.push_back((int)even_ids.size());
+		even_ids.push_back(id);
+	} else {
+		int slot = (int)odd_ids.size();
+		slots.push_back(slot);
+		odd_ids.push_back(id);
+
+		// Update the bitmasks of predecessors: the new generator precedes every odd generator with a greater label
+		// and it is preceded by every odd generator with a smaller label
+		vector<unsigned long long> predecessors(slot/64 + 1, 0);
+		for (int i=0; i<slot; i++) {
+			if (generators[odd_ids[i]].label < label) {
+				predecessors[i/64] |= 1ULL << (i%64);
+			} else {
+				odd_predecessors[i].resize(slot/64 + 1, 0);
+				odd_predecessors[i][slot/64] |= 1ULL << (slot%64);
+			}
+		}
+		odd_predecessors.push_back(predecessors);
+	}
+
+	// Recompute the lexicographical rank of every label (the map is already sorted)
+	lex_ranks.resize(generators.size());
+	int rank = 0;
+	map<string, int>::const_iterator iter;
+	for (iter = ids.begin(); iter != ids.end(); iter++) {
+		lex_ranks[iter->second] = rank++;
+	}
+
+	return id;
+}
+
+int GeneratorRegistry::Find(const string &label) const
+{
+	map<string, int>::const_iterator iter = ids.find(label);
+	if (iter == ids.end()) {
+		return -1;
+	}
+	return iter->second;
+}
+
+// Return the number of bits set in "x"
+static int PopCount(unsigned long long x)
+{
+	int count = 0;
+	while (x) {
+		x &= x - 1;
+		count++;
+	}
+	return count;
+}
+
+// Return the index of the lowest bit set in "x", which must be non-zero
+static int LowestBit(unsigned long long x)
+{
+	int index = 0;
+	while (!(x & 1)) {
+		x >>= 1;
+		index++;
+	}
+	return index;
 }
 
 Word::Word()
 {
+	registry = 0;
+	degree = 0;
+	length = 0;
+	isUnit = false;
+}
+
+Word::Word(const GeneratorRegistry *_registry)
+{
+	registry = _registry;
 	degree = 0;
+	length = 0;
 	isUnit = false;
 }
 
 void Word::Clear()
 {
 	degree = 0;
+	length = 0;
 	isUnit = false;
-	generators.clear();
+	exponents.clear();
+	odd_mask.clear();
 }
 
-void Word::AddPowerOfGenerator(const string &label, int deg, int power)
+int Word::GetEvenExponent(int slot) const
+{
+	if (slot >= (int)exponents.size()) {
+		return 0;
+	}
+	return exponents[slot];
+}
+
+bool Word::HasOddGenerator(int slot) const
+{
+	if (slot/64 >= (int)odd_mask.size()) {
+		return false;
+	}
+	return (odd_mask[slot/64] >> (slot%64)) & 1;
+}
+
+void Word::AddPowerOfGenerator(int id, int power)
 {
 	assert(!IsUnit());
 
@@ -69,19 +180,75 @@ void Word::AddPowerOfGenerator(const string &label, int deg, int power)
 		return;
 	}
 
-	// Check if g is already part of the word
-	if( generators.find(label) == generators.end() ) {
-		// Here, g is not part of the word, so we initialize the power of g to "power"
-		generators[label] = GenPower(deg, power);
+	assert(registry);
+	int slot = registry->GetSlot(id);
+	if (registry->IsEven(id)) {
+		if (slot >= (int)exponents.size()) {
+			exponents.resize(slot+1, 0);
+		}
+		if (exponents[slot] + power > 255) {
+			throw logic_error("The power of generator '" + registry->GetGenerator(id).label + "' is too large.");
+		}
+		exponents[slot] += power;
 	} else {
-		generators[label].power += power;
+		// An odd generator can only appear once in a word
+		assert(power == 1 && !HasOddGenerator(slot));
+		if (slot/64 >= (int)odd_mask.size()) {
+			odd_mask.resize(slot/64+1, 0);
+		}
+		odd_mask[slot/64] |= 1ULL << (slot%64);
+	}
+	degree += registry->GetDegree(id) * power;
+	length += power;
+}
+
+void Word::AddPowerOfGenerator(const string &label, int power)
+{
+	if (!registry) {
+		throw logic_error("The generator with label '" + label + "' can't be looked up without a registry.");
 	}
-	degree += deg * power;
+	int id = registry->Find(label);
+	if (id < 0) {
+		throw logic_error("The generator with label '" + label + "' has not been introduced.");
+	}
+	AddPowerOfGenerator(id, power);
 }
 
 void Word::AddPowerOfGenerator(const Generator &g, int power)
 {
-	AddPowerOfGenerator(g.label, g.degree, power);
+	if (g.id >= 0 && g.registry) {
+		if (!registry) {
+			registry = g.registry;
+		}
+		assert(registry == g.registry);
+		AddPowerOfGenerator(g.id, power);
+	} else {
+		AddPowerOfGenerator(g.label, power);
+	}
+}
+
+int Word::CountOddInversions(const Word &w1, const Word &w2)
+{
+	if (w1.odd_mask.empty() || w2.odd_mask.empty()) {
+		return 0;
+	}
+	assert(w1.registry && w1.registry == w2.registry);
+	const GeneratorRegistry &registry = *w1.registry;
+	int count = 0;
+	for (int i=0; i<(int)w1.odd_mask.size(); i++) {
+		unsigned long long bits = w1.odd_mask[i];
+		while (bits) {
+			int slot = i*64 + LowestBit(bits);
+			bits &= bits - 1;
+
+			const vector<unsigned long long> &predecessors = registry.GetOddPredecessors(slot);
+			int size = (int)min(predecessors.size(), w2.odd_mask.size());
+			for (int j=0; j<size; j++) {
+				count += PopCount(predecessors[j] & w2.odd_mask[j]);
+			}
+		}
+	}
+	return count;
 }
 
 int Word::MultiplyOnLeft(const Generator &g, int power)
@@ -98,36 +265,28 @@ int Word::MultiplyOnLeft(const Generator &g, int power)
 		// (1) The word might become zero if the factor is already present
 		// (2) We may add the factor
 		// (3) We may add the factor and need to multiply by (-1)
-		if (generators.find(g.label) != generators.end()) {
-			return 0;
-		}
-		generators[g.label] = GenPower(g.degree, 1);
-		map<string, GenPower>::const_iterator iter;
-		int position = 0;
-		for (iter = generators.begin(); iter != generators.end(); iter++) {
-			if (iter->first == g.label)
-				break;
-			if (!(isEven(iter->second.degree))) {
-				position++;
-			}
-		}
-		if (isEven(position)) {
-			return 1;
-		} else {
-			return -1;
-		}
+		Word factor;
+		factor.AddPowerOfGenerator(g, 1);
+		return MultiplyOnLeft(factor);
 	}
 }
+
 int Word::MultiplyOnLeft(const Word &word)
 {
-	int sign = 1;
+	assert(!IsUnit());
 
-	map<string, GenPower>::const_reverse_iterator iter;
-	for (iter = word.generators.rbegin(); iter != word.generators.rend(); iter++) {
-		Generator g(iter->first, iter->second.degree);
-		sign *= MultiplyOnLeft(g, iter->second.power);
+	// The product is zero as soon as an odd generator appears in both words
+	int size = (int)min(odd_mask.size(), word.odd_mask.size());
+	for (int i=0; i<size; i++) {
+		if (odd_mask[i] & word.odd_mask[i]) {
+			return 0;
+		}
 	}
 
+	// Moving the odd factors of "word" to their canonical position introduces one sign change for each
+	// odd factor of this word that they have to cross
+	int sign = isEven(CountOddInversions(word, *this)) ? 1 : -1;
+	ConcatenateWords(*this, word, *this);
 	return sign;
 }
 
@@ -141,41 +300,26 @@ int Word::MultiplyOnRight(const Generator &g, int power)
 		AddPowerOfGenerator(g, power);
 		return 1;
 	} else {
-		// Part of the exterior algebra, so three things can happen:
-		// (1) The word might become zero if the factor is already present
-		// (2) We may add the factor
-		// (3) We may add the factor and need to multiply by (-1)
-		if (generators.find(g.label) != generators.end()) {
-			return 0;
-		}
-		generators[g.label] = GenPower(g.degree, 1);
-		map<string, GenPower>::const_reverse_iterator iter;
-		int position = 0;
-		for (iter = generators.rbegin(); iter != generators.rend(); iter++) {
-			if (iter->first == g.label)
-				break;
-			if (!(isEven(iter->second.degree))) {
-				position++;
-			}
-		}
-		if (isEven(position)) {
-			return 1;
-		} else {
-			return -1;
-		}
+		// Part of the exterior algebra, see MultiplyOnLeft
+		Word factor;
+		factor.AddPowerOfGenerator(g, 1);
+		return MultiplyOnRight(factor);
 	}
 }
 
 int Word::MultiplyOnRight(const Word &word)
 {
-	int sign = 1;
-	
-	map<string, GenPower>::const_iterator iter;
-	for (iter = word.generators.begin(); iter != word.generators.end(); iter++) {
-		Generator g(iter->first, iter->second.degree);
-		sign *= MultiplyOnRight(g, iter->second.power);
+	assert(!IsUnit());
+
+	int size = (int)min(odd_mask.size(), word.odd_mask.size());
+	for (int i=0; i<size; i++) {
+		if (odd_mask[i] & word.odd_mask[i]) {
+			return 0;
+		}
 	}
 
+	int sign = isEven(CountOddInversions(*this, word)) ? 1 : -1;
+	ConcatenateWords(*this, *this, word);
 	return sign;
 }
 
@@ -185,34 +329,50 @@ int Word::GetDegree() const
 }
 
 int Word::GetLength() const
+{
+	return length;
+}
+
+string Word::OutputString() const
 {
 	if (IsUnit()) {
-		return 0;
+		return "1";
 	}
 
-	map<string, GenPower>::const_iterator iter;
-	int len = 0;
-	for (iter = generators.begin(); iter != generators.end(); iter++) {
-		len += iter->second.power;
+	if (!registry) {
+		// The empty word
+		return "";
 	}
-	return len;
-}
 
-string Word::OutputString() const
-{
-	map<string, GenPower>::const_iterator iter;
+	// Collect the factors and sort them in the "canonical lexicographical" ordering
+	const GeneratorRegistry &registry = *this->registry;
+	vector<pair<int, int> > factors; // (lexicographical rank, ID)
+	for (int slot=0; slot<(int)exponents.size(); slot++) {
+		if (exponents[slot] > 0) {
+			int id = registry.GetEvenGenerator(slot);
+			factors.push_back(make_pair(registry.GetLexicographicRank(id), id));
+		}
+	}
+	for (int slot=0; slot<(int)odd_mask.size()*64; slot++) {
+		if (HasOddGenerator(slot)) {
+			int id = registry.GetOddGenerator(slot);
+			factors.push_back(make_pair(registry.GetLexicographicRank(id), id));
+		}
+	}
+	sort(factors.begin(), factors.end());
+
 	string output;
-	for (iter = generators.begin(); iter != generators.end(); iter++) {
-		if (iter->second.power == 1) {
-			if (!output.empty())
-				output += " * ";
-			output += iter->first;
-		} else if (iter->second.power > 1) {
-			if (!output.empty())
-				output += " * ";
+	vector<pair<int, int> >::const_iterator iter;
+	for (iter = factors.begin(); iter != factors.end(); iter++) {
+		const Generator &g = registry.GetGenerator(iter->second);
+		int power = isEven(g.degree) ? exponents[registry.GetSlot(g.id)] : 1;
+		if (!output.empty())
+			output += " * ";
+		output += g.label;
+		if (power > 1) {
 			stringstream ss;
-			ss << iter->second.power;
-			output += iter->first + "^" + ss.str();
+			ss << power;
+			output += "^" + ss.str();
 		}
 	}
 	return output;
@@ -221,9 +381,7 @@ string Word::OutputString() const
 void Word::SetToUnit(bool _isUnit)
 {
 	if (_isUnit) {
-		degree = 0;
-		generators.clear();
-		generators["1"] = GenPower(0, 1);
+		Clear();
 		isUnit = true;
 	} else {
 		isUnit = false;
@@ -237,22 +395,59 @@ bool Word::IsUnit() const
 
 void Word::GetFirstFactor(Generator &first_factor, Word &remaining_factors) const
 {
-	map<string, GenPower>::const_iterator iter = generators.begin();
-	if (iter == generators.end()) {
+	if (IsUnit()) {
+		// The unit is treated as a word with a single factor labeled "1"
+		first_factor = Generator("1", 0);
+		remaining_factors.Clear();
+		return;
+	}
+
+	first_factor = registry->GetGenerator(GetFirstFactor(remaining_factors));
+}
+
+int Word::GetFirstFactor(Word &remaining_factors) const
+{
+	assert(!IsUnit());
+
+	// Find the factor whose label comes first
+	assert(this->registry);
+	const GeneratorRegistry &registry = *this->registry;
+	int first_id = -1;
+	for (int slot=0; slot<(int)exponents.size(); slot++) {
+		if (exponents[slot] > 0) {
+			int id = registry.GetEvenGenerator(slot);
+			if (first_id < 0 || registry.GetLexicographicRank(id) < registry.GetLexicographicRank(first_id))
+				first_id = id;
+		}
+	}
+	for (int slot=0; slot<(int)odd_mask.size()*64; slot++) {
+		if (HasOddGenerator(slot)) {
+			int id = registry.GetOddGenerator(slot);
+			if (first_id < 0 || registry.GetLexicographicRank(id) < registry.GetLexicographicRank(first_id))
+				first_id = id;
+		}
+	}
+	if (first_id < 0) {
 		assert(0);
 	}
-	first_factor.label = iter->first;
-	first_factor.degree = iter->second.degree;
 
 	// Now, make "remaining_factors" equal to the remaining factors
-	remaining_factors.Clear();
-	if (iter->second.power > 1) {
-		remaining_factors.AddPowerOfGenerator(iter->first, iter->second.degree, iter->second.power - 1);
-	}
-	iter++;
-	for( ; iter != generators.end(); iter++) {
-		remaining_factors.AddPowerOfGenerator(iter->first, iter->second.degree, iter->second.power);
+	remaining_factors = *this;
+	int slot = registry.GetSlot(first_id);
+	if (registry.IsEven(first_id)) {
+		remaining_factors.exponents[slot]--;
+		while (!remaining_factors.exponents.empty() && remaining_factors.exponents.back() == 0) {
+			remaining_factors.exponents.pop_back();
+		}
+	} else {
+		remaining_factors.odd_mask[slot/64] &= ~(1ULL << (slot%64));
+		while (!remaining_factors.odd_mask.empty() && remaining_factors.odd_mask.back() == 0) {
+			remaining_factors.odd_mask.pop_back();
+		}
 	}
+	remaining_factors.degree -= registry.GetDegree(first_id);
+	remaining_factors.length--;
+	return first_id;
 }
 
 void Word::ConcatenateWords(Word &result, const Word &w1, const Word &w2)
@@ -266,72 +461,195 @@ void Word::ConcatenateWords(Word &result, const Word &w1, const Word &w2)
 		return;
 	}
 
-	result = w2;
-	
-	map<string, GenPower>::const_iterator iter;
-	for (iter = w1.generators.begin(); iter != w1.generators.end(); iter++) {
-		result.AddPowerOfGenerator(iter->first, iter->second.degree, iter->second.power);
+	// Note: "result" may be the same object as "w1" or "w2"
+	SmallArray<unsigned char, 16> exponents;
+	exponents.resize(max(w1.exponents.size(), w2.exponents.size()), 0);
+	for (int i=0; i<(int)exponents.size(); i++) {
+		int power = w1.GetEvenExponent(i) + w2.GetEvenExponent(i);
+		if (power > 255) {
+			throw logic_error("The power of a generator is too large.");
+		}
+		exponents[i] = (unsigned char)power;
+	}
+	SmallArray<unsigned long long, 2> odd_mask;
+	odd_mask.resize(max(w1.odd_mask.size(), w2.odd_mask.size()), 0);
+	for (int i=0; i<(int)odd_mask.size(); i++) {
+		unsigned long long bits1 = i < (int)w1.odd_mask.size() ? w1.odd_mask[i] : 0;
+		unsigned long long bits2 = i < (int)w2.odd_mask.size() ? w2.odd_mask[i] : 0;
+		assert((bits1 & bits2) == 0);
+		odd_mask[i] = bits1 | bits2;
 	}
+	result.registry = w1.registry ? w1.registry : w2.registry;
+	result.degree = w1.degree + w2.degree;
+	result.length = w1.length + w2.length;
+	result.isUnit = false;
+	result.exponents = exponents;
+	result.odd_mask = odd_mask;
 }
 
-bool Word::operator==(const Word& word) const
+int Word::SetProduct(const Word &w1, const Word &w2)
 {
-	if (this->GetLength() != word.GetLength()) {
-		return false;
+	assert(this != &w1 && this != &w2);
+
+	if (w1.IsUnit()) {
+		*this = w2;
+		return 1;
+	} else if (w2.IsUnit()) {
+		*this = w1;
+		return 1;
 	}
-	
+
+	int size = (int)min(w1.odd_mask.size(), w2.odd_mask.size());
+	for (int i=0; i<size; i++) {
+		if (w1.odd_mask[i] & w2.odd_mask[i]) {
+			return 0;
+		}
+	}
+
+	// Same as ConcatenateWords, except that the arrays keep their capacity
+	exponents.resize(max(w1.exponents.size(), w2.exponents.size()));
+	for (int i=0; i<(int)exponents.size(); i++) {
+		int power = w1.GetEvenExponent(i) + w2.GetEvenExponent(i);
+		if (power > 255) {
+			throw logic_error("The power of a generator is too large.");
+		}
+		exponents[i] = (unsigned char)power;
+	}
+	odd_mask.resize(max(w1.odd_mask.size(), w2.odd_mask.size()));
+	for (int i=0; i<(int)odd_mask.size(); i++) {
+		unsigned long long bits1 = i < (int)w1.odd_mask.size() ? w1.odd_mask[i] : 0;
+		unsigned long long bits2 = i < (int)w2.odd_mask.size() ? w2.odd_mask[i] : 0;
+		odd_mask[i] = bits1 | bits2;
+	}
+	registry = w1.registry ? w1.registry : w2.registry;
+	degree = w1.degree + w2.degree;
+	length = w1.length + w2.length;
+	isUnit = false;
+
+	return isEven(CountOddInversions(w1, w2)) ? 1 : -1;
+}
+
+bool Word::operator==(const Word& word) const
+{
 	// Note: Since words are always ordered in the "canonical lexicographical" order, it is sufficient
 	// to check whether two words have the same factors and the same powers for those factors
+	return isUnit == word.isUnit && exponents == word.exponents && odd_mask == word.odd_mask;
+}
 
-	map<string, GenPower>::const_iterator iter;
-	for (iter = word.generators.begin(); iter != word.generators.end(); iter++) {
-		map<string, GenPower>::const_iterator this_iter;
-		this_iter = this->generators.find(iter->first);
+bool Word::operator!=(const Word& word) const
+{
+	return !(*this == word);
+}
 
-		if (this_iter == this->generators.end()) {
-			return false;
-		}
-		
-		if (this_iter->second.power != iter->second.power) {
-			return false;
+bool Word::operator<(const Word& word) const
+{
+	if (degree != word.degree)
+		return degree < word.degree;
+	if (isUnit != word.isUnit)
+		return isUnit;
+	if (exponents != word.exponents)
+		return exponents < word.exponents;
+	return odd_mask < word.odd_mask;
+}
+
+size_t Word::Hash() const
+{
+	// FNV-1a over the exponents and the odd bitmask
+	unsigned long long h = 14695981039346656037ULL;
+	for (size_t i=0; i<exponents.size(); i++) {
+		h = (h ^ exponents[i]) * 1099511628211ULL;
+	}
+	for (size_t i=0; i<odd_mask.size(); i++) {
+		h = (h ^ odd_mask[i]) * 1099511628211ULL;
+		h ^= h >> 29;
+	}
+	if (isUnit)
+		h = ~h;
+	return (size_t)h;
+}
+
+IndexedBasis::IndexedBasis()
+{
+	basis = 0;
+	mask = 0;
+}
+
+IndexedBasis::IndexedBasis(const OrderedBasis &_basis)
+{
+	SetBasis(_basis);
+}
+
+void IndexedBasis::SetBasis(const OrderedBasis &_basis)
+{
+	basis = &_basis;
+
+	// Use a table with at least twice as many buckets as there are words, so that probe sequences stay short
+	size_t size = 16;
+	while (size < 2*basis->size()) {
+		size *= 2;
+	}
+	mask = size - 1;
+	buckets.assign(size, -1);
+
+	for (int i=0; i<(int)basis->size(); i++) {
+		size_t bucket = (*basis)[i].Hash() & mask;
+		while (buckets[bucket] != -1) {
+			bucket = (bucket + 1) & mask;
 		}
+		buckets[bucket] = i;
 	}
+}
 
-	return true;
+const OrderedBasis &IndexedBasis::GetBasis() const
+{
+	return *basis;
+}
+
+int IndexedBasis::GetSize() const
+{
+	return basis ? (int)basis->size() : 0;
+}
+
+const Word &IndexedBasis::operator[](int i) const
+{
+	return (*basis)[i];
 }
 
-map<string, int> GradedVectorSpace::globalGeneratorsList;
+int IndexedBasis::GetIndex(const Word &word) const
+{
+	if (buckets.empty()) {
+		return -1;
+	}
+	size_t bucket = word.Hash() & mask;
+	while (buckets[bucket] != -1) {
+		if ((*basis)[buckets[bucket]] == word) {
+			return buckets[bucket];
+		}
+		bucket = (bucket + 1) & mask;
+	}
+	return -1;
+}
 
 GradedVectorSpace::GradedVectorSpace()
 {
 	maxDegree = 0;
+	registry = make_shared<GeneratorRegistry>();
 }
 
 GradedVectorSpace::GradedVectorSpace(const vector<Generator> &_basis)
 {
 	maxDegree = 0;
+	registry = make_shared<GeneratorRegistry>();
 	vector<Generator>::const_iterator iter;
 	for (iter = _basis.begin(); iter != _basis.end(); iter++) {
-		if (isEven(iter->degree)) {
-			even_basis.push_back(*iter);
-		} else {
-			odd_basis.push_back(*iter);
-		}
-		if (iter->degree > maxDegree) {
-			maxDegree = iter->degree;
-		}
+		AddGenerator(iter->label, iter->degree);
 	}
 }
 
 void GradedVectorSpace::AddGenerator(const string &label, int degree)
 {
-	Generator gen(label, degree);
-
-	// Check if a generator with the same name already exists
-	if (globalGeneratorsList.find(label) != globalGeneratorsList.end()) {
-		throw logic_error("The generator with label '" + label +"' already exists.");
-	}
-	globalGeneratorsList[label] = degree;
+	// This throws if a generator with the same name already exists
+	const Generator &gen = registry->GetGenerator(registry->Intern(label, degree));
 
 	if (isEven(degree)) {
 		even_basis.push_back(gen);
@@ -342,19 +660,35 @@ void GradedVectorSpace::AddGenerator(const string &label, int degree)
 		maxDegree = degree;
 }
 
-int GradedVectorSpace::GetGeneratorDegree(const string &label)
+int GradedVectorSpace::GetGeneratorDegree(const string &label) const
 {
-	map<string,int>::iterator iter = globalGeneratorsList.find(label);
-	if (iter == globalGeneratorsList.end()) {
+	int id = registry->Find(label);
+	if (id < 0) {
 		throw logic_error("The generator with label '" + label + "' has not been introduced.");
 	}
-	return iter->second;
+	return registry->GetDegree(id);
+}
+
+int GradedVectorSpace::GetMinimalDegree() const
+{
+	vector<Generator> generators(even_basis);
+	generators.insert(generators.end(), odd_basis.begin(), odd_basis.end());
+	int min_degree = 0;
+	vector<Generator>::const_iterator iter;
+	for (iter = generators.begin(); iter != generators.end(); iter++) {
+		if (iter->degree <= 0) {
+			throw logic_error("The generators of X must have a positive degree.");
+		}
+		if (min_degree == 0 || iter->degree < min_degree)
+			min_degree = iter->degree;
+	}
+	return min_degree;
 }
 
-vector<vector<Generator> > GradedVectorSpace::GetDegreeIndexedBasis()
+vector<vector<Generator> > GradedVectorSpace::GetDegreeIndexedBasis() const
 {
-	vector<vector<Generator> > basis(50); // Start with an basis that is empty in degrees 0-49
-	vector<Generator>::iterator iter;
+	vector<vector<Generator> > basis(maxDegree+1); // Start with an basis that is empty in every degree
+	vector<Generator>::const_iterator iter;
 
 	// First iterate over even generators
 	for (iter = even_basis.begin(); iter != even_basis.end(); iter++) {
@@ -368,6 +702,19 @@ vector<vector<Generator> > GradedVectorSpace::GetDegreeIndexedBasis()
 	return basis;
 }
 
+static bool CompareIDs(const Generator &a, const Generator &b)
+{
+	return a.id < b.id;
+}
+
+vector<Generator> GradedVectorSpace::GetBasis() const
+{
+	// The registry gives increasing IDs to the generators, so the even and the odd generators are merged by ID
+	vector<Generator> basis;
+	merge(even_basis.begin(), even_basis.end(), odd_basis.begin(), odd_basis.end(), back_inserter(basis), CompareIDs);
+	return basis;
+}
+
 Word CreateWord(const vector<Generator> &basis, int length, int *indices)
 {
 	Word word;
@@ -497,16 +844,19 @@ void GetOrderedBasisExteriorAlgebra(OrderedBasis &ext_alg_basis, const vector<Ge
 
 FreeCGA::FreeCGA()
 {
+	T.registry = X.registry;
 }
 
 FreeCGA::FreeCGA(const GradedVectorSpace &_X)
 {
-	X = _X;
+	SetGradedVectorSpace(_X);
 }
 
 void FreeCGA::SetGradedVectorSpace(const GradedVectorSpace &_X)
 {
 	X = _X;
+	T = GradedVectorSpace();
+	T.registry = X.registry;
 }
 
 void FreeCGA::Test1()
@@ -623,82 +973,76 @@ void FreeCGA::Test3()
 	}
 }
 
-void FreeCGA::GetDegreeIndexedBasis(vector<OrderedBasis> &basis, int degree, int minLength)
+void FreeCGA::GetBasisInDegree(OrderedBasis &basis, int degree, int minLength) const
 {
-	// Start with a basis that is empty in each degree. Allocate space for degrees from 0 to 499.
+	PROFILE_SCOPE(PHASE_ENUMERATION);
 	basis.clear();
-	basis.resize(100);
+	BasisIterator iter(*this, degree, minLength, false);
+	Word word;
+	while (iter.Next(word)) {
+		basis.push_back(word);
+	}
+	PROFILE_COUNT(PHASE_ENUMERATION, (long long)basis.size());
+}
 
-	// Assuming that X = {X^i}, i>=2, it suffices to look at words of length up to ceil(degree+1/2)
-	int maxLength = (int)ceil( ((double)(degree+1)) / 2.0 );
+void FreeCGA::GetBasisInDegreeExtended(OrderedBasis &basis, int degree, int minLength) const
+{
+	PROFILE_SCOPE(PHASE_ENUMERATION);
+	basis.clear();
+	BasisIterator iter(*this, degree, minLength, true);
+	Word word;
+	while (iter.Next(word)) {
+		basis.push_back(word);
+	}
+	PROFILE_COUNT(PHASE_ENUMERATION, (long long)basis.size());
+}
 
-	// Recall that /\X = Symm(X^even) (x) Ext(X^odd)
-	// Here, "n" represents the length of words in Symm(X^even) and "m" represents the length of words in Ext(X^odd)
-	// We iterate over all possible words starting in length 1 and ending in length "maxLength"
-	for (int len=minLength; len<=maxLength; len++) {
-		int n = len;
-		int m = 0;
-	
-		// As soon as n is negative or m is greater than the dimension of X^odd, we have to stop
-		OrderedBasis symm_basis, ext_basis;
-		while (n >= 0 && m <= (int)X.odd_basis.size()) {
-			GetOrderedBasisSymmetricAlgebra(symm_basis, X.even_basis, n);
-			GetOrderedBasisExteriorAlgebra(ext_basis, X.odd_basis, m);
-			
-			// Add all products of words in symm_basis and ext_basis
-			OrderedBasis::iterator iter_symm, iter_ext;
-			Word word;
-			for (iter_ext = ext_basis.begin() ; iter_ext != ext_basis.end(); iter_ext++) {
-				for (iter_symm = symm_basis.begin(); iter_symm != symm_basis.end(); iter_symm++) {
-					Word::ConcatenateWords(word, *iter_symm, *iter_ext);
-					AddIndexedOrderedBasisElement(basis, word);
-				}
-			}
-			
-			// Next, increment the length of m and decrement the length of n
-			n--;
-			m = len - n;
+void FreeCGA::ExtendBasisInDegree(OrderedBasis &basis, int degree, int first_generator) const
+{
+	PROFILE_SCOPE(PHASE_ENUMERATION);
+#ifdef CDGA_PROFILE
+	size_t size = basis.size();
+#endif
+	vector<Generator> T_basis = T.GetBasis();
+	for (int t=first_generator; t<(int)T_basis.size(); t++) {
+		// The words x * t, where x is a word of /\^{+}X, in the order of the block of t in a BasisIterator
+		Word t_word;
+		t_word.AddPowerOfGenerator(T_basis[t], 1);
+		BasisIterator iter(*this, degree - T_basis[t].degree, 1, false);
+		Word word;
+		while (iter.Next(word)) {
+			Word::ConcatenateWords(word, word, t_word);
+			basis.push_back(word);
 		}
 	}
+	PROFILE_COUNT(PHASE_ENUMERATION, (long long)(basis.size() - size));
 }
 
-void FreeCGA::GetDegreeIndexedBasisExtended(vector<OrderedBasis> &basis, int degree, int minLength)
+void FreeCGA::GetDegreeIndexedBasis(vector<OrderedBasis> &basis, int degree, int minLength)
 {
-	// Start with a basis that is empty in each degree. Allocate space for degrees from 0 to 99.
+	// The words of degree "degree"+1 are the targets of the differential, so they are included as well
 	basis.clear();
-	basis.resize(100);
+	basis.resize(degree+2);
+	for (int deg=0; deg<=degree+1; deg++) {
+		GetBasisInDegree(basis[deg], deg, minLength);
+	}
+}
 
-	// First, get a basis for /\^{>=n}X
-	// TODO: This is rather unefficient, having the main routine called twice for different word lengths. Could be optimized.
-	vector<OrderedBasis> X_basis;
-	GetDegreeIndexedBasis(basis, degree, minLength);
-	GetDegreeIndexedBasis(X_basis, degree, 1);
-	
-	// Assuming that X = {X^i}, i>=2, it suffices to look at words of length up to ceil(degree+1/2)
-	int maxLength = (int)ceil( ((double)(degree+1)) / 2.0 );
-
-	// Now, compute a basis for /\^{+} X (x) T
-	vector<vector<Generator> > T_basis = T.GetDegreeIndexedBasis();
-	for (int i=0; i<(int)T_basis.size(); i++) {
-		if (!T_basis[i].empty()) {
-			vector<Generator>::iterator Titer;
-			for (Titer = T_basis[i].begin(); Titer != T_basis[i].end(); Titer++) {
-				Word T_word;
-				T_word.AddPowerOfGenerator(*Titer, 1);
-				// For each element of T, we will consider all possible products with elements of X_basis
-				for (int deg=0; deg<(int)X_basis.size(); deg++) {
-					OrderedBasis::iterator Xiter;
-					Word word;
-					for (Xiter = X_basis[deg].begin(); Xiter != X_basis[deg].end(); Xiter++) {
-						Word::ConcatenateWords(word, *Xiter, T_word);
-						AddIndexedOrderedBasisElement(basis, word);
-					}
-				}
-			}
-		}
+void FreeCGA::GetDegreeIndexedBasisExtended(vector<OrderedBasis> &basis, int degree, int minLength)
+{
+	basis.clear();
+	basis.resize(degree+2);
+	for (int deg=0; deg<=degree+1; deg++) {
+		GetBasisInDegreeExtended(basis[deg], deg, minLength);
 	}
 }
 
+// This adds a generator to the vector space X
+void FreeCGA::AddGenerator(const string &label, int degree)
+{
+	X.AddGenerator(label, degree);
+}
+
 // This adds a generator to the vector space T
 void FreeCGA::AddExtensionGenerator(string label, int degree)
 {
@@ -707,11 +1051,17 @@ void FreeCGA::AddExtensionGenerator(string label, int degree)
 
 LinearCombination::LinearCombination()
 {
+	registry = 0;
+}
+
+LinearCombination::LinearCombination(const GeneratorRegistry *_registry)
+{
+	registry = _registry;
 }
 
-void LinearCombination::AddTerm(int coeff, const Word &word)
+void LinearCombination::AddTerm(const Coefficient &coeff, const Word &word)
 {
-	if (coeff != 0) {
+	if (!coeff.IsZero()) {
 		Term term;
 		term.coeff = coeff;
 		term.word = word;
@@ -727,7 +1077,7 @@ void LinearCombination::AddTerms(const LinearCombination &lc)
 	}
 }
 
-void LinearCombination::ScalarMultiply(int coeff)
+void LinearCombination::ScalarMultiply(const Coefficient &coeff)
 {
 	vector<Term>::iterator iter;
 	for (iter = terms.begin(); iter != terms.end(); iter++) {
@@ -779,15 +1129,20 @@ void LinearCombination::MultiplyOnRight(const Word &word)
 }
 
 // This method returns the coordinates of a vector (a linear combination) in terms of a certain ordered basis
-// The pointer "coordinates" must point to an array of the proper size, that is its size must be the number of
-// elements in the basis.
-void LinearCombination::GetCoordinates(int *coordinates, const OrderedBasis &basis) const
+// The vector "coordinates" is resized to the number of elements in the basis.
+void LinearCombination::GetCoordinates(vector<Coefficient> &coordinates, const OrderedBasis &basis) const
 {
-	int dim = (int)basis.size();
+	IndexedBasis indexed_basis(basis);
+	GetCoordinates(coordinates, indexed_basis);
+}
+
+void LinearCombination::GetCoordinates(vector<Coefficient> &coordinates, const IndexedBasis &basis) const
+{
+	int dim = basis.GetSize();
 	assert(dim > 0);
 
 	// Clear the coordinates first so that they are 0 everywhere
-	memset(coordinates, 0, dim*sizeof(int));
+	coordinates.assign(dim, Coefficient());
 
 	// Return the zero vector if the linear combination is empty
 	if (terms.empty()) {
@@ -796,15 +1151,34 @@ void LinearCombination::GetCoordinates(int *coordinates, const OrderedBasis &bas
 
 	vector<Term>::const_iterator iter_term;
 	for (iter_term = terms.begin(); iter_term != terms.end(); iter_term++) {
-		int i;
-		for (i=0; i<dim; i++) {
-			if (basis[i] == iter_term->word) {
-				coordinates[i] += iter_term->coeff;
-				break;
-			}
-		}
-		assert(i<dim); // Assert if the term is not in the basis
+		int i = basis.GetIndex(iter_term->word);
+		assert(i >= 0); // Assert if the term is not in the basis
+		coordinates[i] += iter_term->coeff;
+	}
+}
+
+void LinearCombination::GetCoordinates(CoefficientVector &coordinates, const IndexedBasis &basis) const
+{
+	coordinates.clear();
+	vector<Term>::const_iterator iter_term;
+	for (iter_term = terms.begin(); iter_term != terms.end(); iter_term++) {
+		int i = basis.GetIndex(iter_term->word);
+		assert(i >= 0); // Assert if the term is not in the basis
+		coordinates.push_back(make_pair((long long)i, iter_term->coeff));
+	}
+	NormalizeCoefficientVector(coordinates);
+}
+
+void LinearCombination::GetCoordinates(CoefficientVector &coordinates, const BasisRanker &basis, int degree) const
+{
+	coordinates.clear();
+	vector<Term>::const_iterator iter_term;
+	for (iter_term = terms.begin(); iter_term != terms.end(); iter_term++) {
+		long long i = basis.Rank(iter_term->word);
+		assert(i >= 0 && iter_term->word.GetDegree() == degree); // Assert if the term is not in the basis
+		coordinates.push_back(make_pair(i, iter_term->coeff));
 	}
+	NormalizeCoefficientVector(coordinates);
 }
 
 
@@ -825,18 +1199,16 @@ string LinearCombination::OutputString() const
 
 	int i = 0;
 	for (iter = terms.begin(); iter != terms.end(); iter++) {
-		if (i == 0 && iter->coeff == -1) {
+		if (i == 0 && iter->coeff.IsMinusOne()) {
 			output += "-";
-		} else if (i > 0 && iter->coeff == -1) {
+		} else if (i > 0 && iter->coeff.IsMinusOne()) {
 			output += " - ";
 		} else if (i > 0) {
 			output += " + ";
 		}
 
-		if (iter->coeff != 1 && iter->coeff != -1) {
-			stringstream ss;
-			ss << iter->coeff;
-			output += "(" + ss.str() + ")";
+		if (!iter->coeff.IsOne() && !iter->coeff.IsMinusOne()) {
+			output += "(" + iter->coeff.ToString() + ")";
 		}
 
 		output += iter->word.OutputString();
@@ -854,8 +1226,67 @@ ostream& operator<<(ostream&, const LinearCombination&)
 {
 }*/
 
+DifferentialCache::DifferentialCache()
+{
+	Clear();
+}
+
+int DifferentialCache::GetWordID(const Word &word)
+{
+	size_t bucket = word.Hash() & mask;
+	while (buckets[bucket] != -1) {
+		if (words[buckets[bucket]] == word) {
+			return buckets[bucket];
+		}
+		bucket = (bucket + 1) & mask;
+	}
+
+	int id = (int)words.size();
+	words.push_back(word);
+	differential_lists.push_back(-1);
+	buckets[bucket] = id;
+	// Keep at least twice as many buckets as there are words, so that probe sequences stay short
+	if (2*words.size() > buckets.size()) {
+		Rehash();
+	}
+	return id;
+}
+
+void DifferentialCache::Rehash()
+{
+	buckets.assign(2*buckets.size(), -1);
+	mask = buckets.size() - 1;
+	for (int id=0; id<(int)words.size(); id++) {
+		size_t bucket = words[id].Hash() & mask;
+		while (buckets[bucket] != -1) {
+			bucket = (bucket + 1) & mask;
+		}
+		buckets[bucket] = id;
+	}
+}
+
+void DifferentialCache::SetDifferential(int id, const SparseVector &d)
+{
+	assert(!IsCached(id));
+	differential_lists[id] = differentials.Add(d);
+}
+
+void DifferentialCache::Clear()
+{
+	vector<Word>().swap(words);
+	vector<int>(16, -1).swap(buckets);
+	mask = buckets.size() - 1;
+	vector<int>().swap(differential_lists);
+	differentials.Clear();
+}
+
 Differential::Differential()
 {
+	registry = 0;
+	compiled = false;
+	has_large = false;
+	thread_count = 1;
+	caches.resize(1);
 	SetDifferentialToZero("1");
 }
 
@@ -863,12 +1294,59 @@ Differential::Differential()
 void Differential::SetDifferential(const string &generator_label, const LinearCombination &a)
 {
 	differential[generator_label] = a;
+	Invalidate(generator_label);
 }
 
 void Differential::SetDifferentialToZero(const string &generator_label)
 {
 	LinearCombination a;
 	differential[generator_label] = a;
+	Invalidate(generator_label);
+}
+
+void Differential::Invalidate(const string &generator_label)
+{
+	// A generator registered after the last compilation can't be a factor of a cached word, so the differentials of
+	// the cached words don't change. This lets a model grow (see AddExtensionGenerator) without losing its cache.
+	int id = registry ? registry->Find(generator_label) : -1;
+	if (id >= (int)generator_words.size()) {
+		compiled = false;
+	} else {
+		ClearCache();
+	}
+}
+
+int Differential::GetTermCount(const string &generator_label) const
+{
+	map<string, LinearCombination>::const_iterator iter = differential.find(generator_label);
+	if (iter == differential.end()) {
+		return 0;
+	}
+	return (int)iter->second.terms.size();
+}
+
+const LinearCombination *Differential::GetDifferential(const string &generator_label) const
+{
+	map<string, LinearCombination>::const_iterator iter = differential.find(generator_label);
+	if (iter == differential.end()) {
+		return 0;
+	}
+	return &iter->second;
+}
+
+void Differential::SetGeneratorRegistry(const GeneratorRegistry &_registry)
+{
+	registry = &_registry;
+	ClearCache();
+}
+
+void Differential::SetThreadCount(int count)
+{
+	if (count <= 0) {
+		count = (int)thread::hardware_concurrency();
+	}
+	thread_count = max(count, 1);
+	caches.resize(thread_count);
 }
 
 // Evaluate the differential on a word and store the result in "result"
@@ -877,64 +1355,401 @@ void Differential::EvaluateDifferential(LinearCombination &result, const Word &w
 	// First, make the linear combination zero
 	result.MakeZero();
 
-	Generator first_factor;
+	if (!compiled) {
+		Compile();
+	}
+	DifferentialCache &cache = caches[0];
+	int id;
+	if (IsLargeDifferential(cache, word, id)) {
+		CoefficientVector d;
+		EvaluateLargeDifferential(cache, word, d);
+		CoefficientVector::const_iterator iter;
+		for (iter = d.begin(); iter != d.end(); iter++) {
+			result.AddTerm(iter->second, cache.GetWord((int)iter->first));
+		}
+		return;
+	}
+	const SparseVector::value_type *iter;
+	for (iter = cache.DifferentialBegin(id); iter != cache.DifferentialEnd(id); iter++) {
+		result.AddTerm(iter->second, cache.GetWord((int)iter->first));
+	}
+}
+
+void Differential::ClearCache()
+{
+	vector<DifferentialCache>::iterator iter;
+	for (iter = caches.begin(); iter != caches.end(); iter++) {
+		iter->Clear();
+	}
+	compiled = false;
+}
+
+void Differential::Compile()
+{
+	if (!registry) {
+		throw logic_error("The differential has no generator registry.");
+	}
+	const GeneratorRegistry &registry = *this->registry;
+	int size = registry.GetSize();
+	generator_words.assign(size, Word());
+	generator_differentials.assign(size, vector<Term>());
+	defined.assign(size, false);
+	large.assign(size, false);
+	has_large = false;
+
+	for (int id=0; id<size; id++) {
+		generator_words[id].AddPowerOfGenerator(registry.GetGenerator(id), 1);
+	}
+
+	map<string, LinearCombination>::const_iterator iter;
+	for (iter = differential.begin(); iter != differential.end(); iter++) {
+		// The differential of the unit "1" is zero, and a generator which was never introduced can't appear in a word
+		int id = registry.Find(iter->first);
+		if (id < 0) {
+			continue;
+		}
+		vector<Term>::const_iterator iter_term;
+		for (iter_term = iter->second.terms.begin(); iter_term != iter->second.terms.end(); iter_term++) {
+			if (!iter_term->coeff.IsZero()) {
+				generator_differentials[id].push_back(*iter_term);
+			}
+			if (!iter_term->coeff.IsSmall() || iter_term->coeff.GetSmall() != (int)iter_term->coeff.GetSmall()) {
+				large[id] = true;
+				has_large = true;
+			}
+		}
+		defined[id] = true;
+	}
+	compiled = true;
+}
+
+int Differential::GetCachedDifferential(DifferentialCache &cache, const Word &word) const
+{
+	assert(compiled);
+
+	int id = cache.GetWordID(word);
+	if (cache.IsCached(id)) {
+		return id;
+	}
+	if (word.IsUnit()) {
+		// The differential of the unit is zero
+		cache.terms.clear();
+		cache.SetDifferential(id, cache.terms);
+		return id;
+	}
+
 	Word remaining_factors;
-	word.GetFirstFactor(first_factor, remaining_factors);
-	
-	// If "word" consists of only one factor, we know the result (it was given to us by the user)
-	// If "word" has length 2 or greater, we need to apply Leibniz' rule
-	if (word.GetLength() <= 1) {
-		map<string, LinearCombination>::iterator iter = differential.find(first_factor.label);
-		if (iter == differential.end()) {
-			throw logic_error("There is no differential defined for generator '" + first_factor.label + "'.");
+	int first_id = word.GetFirstFactor(remaining_factors);
+	if (!defined[first_id]) {
+		throw logic_error("There is no differential defined for generator '" + registry->GetGenerator(first_id).label + "'.");
+	}
+	const vector<Term> &first_differential = generator_differentials[first_id];
+	vector<Term>::const_iterator iter_term;
+	// The differential is built in the scratch vector of the cache. It is only filled once the recursive call below has
+	// returned, so that call can use the same vector.
+	SparseVector &d = cache.terms;
+
+	if (word.GetLength() == 1) {
+		// If "word" consists of only one factor, we know the result (it was given to us by the user)
+		d.clear();
+		for (iter_term = first_differential.begin(); iter_term != first_differential.end(); iter_term++) {
+			d.push_back(make_pair((long long)cache.GetWordID(iter_term->word), iter_term->coeff.GetSmall()));
 		}
-		result = iter->second;
-	}
-	if (word.GetLength() > 1) {
-		LinearCombination first_term;
-		// The first term is the product of the differential of the first factor and of the remaining factors
-		map<string, LinearCombination>::iterator iter = differential.find(first_factor.label);
-		if (iter == differential.end()) {
-			throw logic_error("There is no differential defined for generator '" + first_factor.label + "'.");
+	} else {
+		// If "word" has length 2 or greater, we need to apply Leibniz' rule:
+		// d(first_factor * remaining_factors) = d(first_factor) * remaining_factors +/- first_factor * d(remaining_factors)
+		// where d(remaining_factors) comes from the cache. Since the remaining factors of a basis word are shared by many
+		// other words, this turns the evaluation of the differential into dynamic programming over the words of lower degree.
+		int remaining_id = GetCachedDifferential(cache, remaining_factors);
+		if (cache.IsLarge(remaining_id)) {
+			cache.SetLarge(id);
+			return id;
 		}
-		first_term = iter->second;
-		first_term.MultiplyOnRight(remaining_factors);
 
-		// Next, we need to add the product "first_factor" and then the differential of "remaining_factors"
-		LinearCombination remaining_factors_result;
-		EvaluateDifferential(remaining_factors_result, remaining_factors);
-		
-		if (!isEven(first_factor.degree)) {
-			remaining_factors_result.ScalarMultiply(-1);
+		d.clear();
+		for (iter_term = first_differential.begin(); iter_term != first_differential.end(); iter_term++) {
+			int sign = cache.product.SetProduct(iter_term->word, remaining_factors);
+			if (sign != 0) {
+				d.push_back(make_pair((long long)cache.GetWordID(cache.product), sign * iter_term->coeff.GetSmall()));
+			}
+		}
+
+		// Note: GetWordID may add words, so the words of the cache are only accessed by ID. The differentials of the
+		// cache don't move until SetDifferential is called.
+		int first_sign = isEven(generator_words[first_id].GetDegree()) ? 1 : -1;
+		const SparseVector::value_type *iter;
+		for (iter = cache.DifferentialBegin(remaining_id); iter != cache.DifferentialEnd(remaining_id); iter++) {
+			int sign = cache.product.SetProduct(generator_words[first_id], cache.GetWord((int)iter->first));
+			if (sign != 0) {
+				d.push_back(make_pair((long long)cache.GetWordID(cache.product), first_sign * sign * iter->second));
+			}
 		}
-		remaining_factors_result.MultiplyOnLeft(first_factor);
+	}
 
-		result.AddTerms(first_term); // First term in Leibniz' rule
-		result.AddTerms(remaining_factors_result); // Second term in Leibniz' rule
+	// Coefficients which add up beyond 64 bits are rare, and the word is then evaluated with Coefficients
+	if (TryNormalizeSparseVector(d)) {
+		cache.SetDifferential(id, d);
+	} else {
+		cache.SetLarge(id);
+	}
+	return id;
+}
+
+bool Differential::HasLargeFactor(const Word &word) const
+{
+	if (word.IsUnit()) {
+		return false;
 	}
+	for (int slot=0; slot<word.GetEvenSlotCount(); slot++) {
+		if (word.GetEvenExponent(slot) != 0 && large[registry->GetEvenGenerator(slot)]) {
+			return true;
+		}
+	}
+	for (int slot=0; slot<word.GetOddSlotCount(); slot++) {
+		if (word.HasOddGenerator(slot) && large[registry->GetOddGenerator(slot)]) {
+			return true;
+		}
+	}
+	return false;
 }
 
-// The differential matrix must be of size (dim_target) x (dim_source).
-// The first index should represent the column number and the second index should represent the row number.
+bool Differential::IsLargeDifferential(DifferentialCache &cache, const Word &word, int &id) const
+{
+	if (has_large && HasLargeFactor(word)) {
+		return true;
+	}
+	id = GetCachedDifferential(cache, word);
+	return cache.IsLarge(id);
+}
 
-void Differential::ComputeDifferentialMatrix(int **differential_matrix, const OrderedBasis &source, const OrderedBasis &target)
+void Differential::EvaluateLargeDifferential(DifferentialCache &cache, const Word &word, CoefficientVector &d) const
 {
-	// Compute the differential on each element of source
-	int dim_source = (int)source.size();
-	int dim_target = (int)target.size();
-	assert(dim_source > 0 && dim_target > 0);
+	Word remaining_factors;
+	int first_id = word.GetFirstFactor(remaining_factors);
+	if (!defined[first_id]) {
+		throw logic_error("There is no differential defined for generator '" + registry->GetGenerator(first_id).label + "'.");
+	}
+	const vector<Term> &first_differential = generator_differentials[first_id];
+	vector<Term>::const_iterator iter_term;
+
+	// The same as GetCachedDifferential, with Coefficients. These words are rare, so their differentials aren't kept.
+	d.clear();
+	if (word.GetLength() == 1) {
+		for (iter_term = first_differential.begin(); iter_term != first_differential.end(); iter_term++) {
+			d.push_back(make_pair((long long)cache.GetWordID(iter_term->word), iter_term->coeff));
+		}
+		NormalizeCoefficientVector(d);
+		return;
+	}
 
-	LinearCombination result;
+	CoefficientVector remaining;
+	int remaining_id;
+	if (IsLargeDifferential(cache, remaining_factors, remaining_id)) {
+		EvaluateLargeDifferential(cache, remaining_factors, remaining);
+	} else {
+		const SparseVector::value_type *iter;
+		for (iter = cache.DifferentialBegin(remaining_id); iter != cache.DifferentialEnd(remaining_id); iter++) {
+			remaining.push_back(make_pair(iter->first, Coefficient(iter->second)));
+		}
+	}
 
-	for (int i=0; i<dim_source; i++) {
-		EvaluateDifferential(result, source[i]);
-		int *coords = new int[dim_target];
-		result.GetCoordinates(coords, target);
-		for (int j=0; j<dim_target; j++) {
-			differential_matrix[j][i] = coords[j];
+	for (iter_term = first_differential.begin(); iter_term != first_differential.end(); iter_term++) {
+		int sign = cache.product.SetProduct(iter_term->word, remaining_factors);
+		if (sign != 0) {
+			d.push_back(make_pair((long long)cache.GetWordID(cache.product), sign > 0 ? iter_term->coeff : -iter_term->coeff));
 		}
-		delete [] coords;
 	}
+	int first_sign = isEven(generator_words[first_id].GetDegree()) ? 1 : -1;
+	CoefficientVector::const_iterator iter;
+	for (iter = remaining.begin(); iter != remaining.end(); iter++) {
+		int sign = first_sign * cache.product.SetProduct(generator_words[first_id], cache.GetWord((int)iter->first));
+		if (sign != 0) {
+			d.push_back(make_pair((long long)cache.GetWordID(cache.product), sign > 0 ? iter->second : -iter->second));
+		}
+	}
+	NormalizeCoefficientVector(d);
+}
+
+// The differential matrix will be of size (dim_target) x (dim_source).
+// Each column is the image of one element of the source basis.
+
+// The words of the source basis are stored in an OrderedBasis (possibly only a chunk of the basis), and the
+// coordinates are found with an IndexedBasis or with a BasisRanker
+struct Differential::ColumnSource
+{
+	const OrderedBasis *source;
+	const IndexedBasis *target;
+	const BasisRanker *ranker;
+	long long dim_source;
+	long long dim_target;
+
+	long long GetIndex(const Word &word) const
+	{
+		return ranker ? ranker->Rank(word) : target->GetIndex(word);
+	}
+};
+
+void Differential::ComputeColumns(SparseMatrix &columns, const ColumnSource &source, DifferentialCache &cache, long long begin, long long end) const
+{
+	SparseVector column;
+	CoefficientVector large_column;
+	PROFILE_TIMER(evaluation);
+	PROFILE_TIMER(coordinates);
+
+	for (long long i=begin; i<end; i++) {
+		PROFILE_START(evaluation);
+		int id;
+		bool is_large = IsLargeDifferential(cache, (*source.source)[(size_t)i], id);
+		PROFILE_STOP(evaluation);
+		if (is_large) {
+			PROFILE_START(evaluation);
+			EvaluateLargeDifferential(cache, (*source.source)[(size_t)i], large_column);
+			PROFILE_STOP(evaluation);
+			PROFILE_START(coordinates);
+			CoefficientVector::iterator iter;
+			for (iter = large_column.begin(); iter != large_column.end(); iter++) {
+				iter->first = source.GetIndex(cache.GetWord((int)iter->first));
+				assert(iter->first >= 0); // Assert if the term is not in the basis
+			}
+			PROFILE_STOP(coordinates);
+			NormalizeCoefficientVector(large_column);
+			columns.AppendColumn(large_column);
+			continue;
+		}
+
+		// The coordinates are read directly from the cache, without building a LinearCombination
+		PROFILE_START(coordinates);
+		column.clear();
+		const SparseVector::value_type *iter;
+		for (iter = cache.DifferentialBegin(id); iter != cache.DifferentialEnd(id); iter++) {
+			long long index = source.GetIndex(cache.GetWord((int)iter->first));
+			assert(index >= 0); // Assert if the term is not in the basis
+			column.push_back(make_pair(index, iter->second));
+		}
+		PROFILE_STOP(coordinates);
+		PROFILE_COUNT(PHASE_COORDINATES, (long long)column.size());
+		NormalizeSparseVector(column);
+		columns.AppendColumn(column);
+	}
+
+	// The times of a block are added up before they are recorded, so the threads rarely wait for the profiler
+	PROFILE_ADD_TIMER(PHASE_EVALUATION, evaluation);
+	PROFILE_COUNT(PHASE_EVALUATION, end - begin);
+	PROFILE_ADD_TIMER(PHASE_COORDINATES, coordinates);
+}
+
+void Differential::ComputeDifferentialMatrix(SparseMatrix &differential_matrix, const ColumnSource &source)
+{
+	assert(source.dim_source > 0 && source.dim_target > 0);
+	if (!compiled) {
+		Compile();
+	}
+
+	differential_matrix.Reset(source.dim_target);
+	if (thread_count == 1) {
+		ComputeColumns(differential_matrix, source, caches[0], 0, source.dim_source);
+		return;
+	}
+
+	// The columns are split in blocks which the threads take in turn. Each block is stored in its own matrix, and the
+	// blocks are then appended in order, so the result does not depend on which thread computed which block.
+	const long long block_size = 1024;
+	long long num_blocks = (source.dim_source + block_size - 1) / block_size;
+	vector<SparseMatrix> blocks((size_t)num_blocks);
+	vector<exception_ptr> errors(thread_count);
+	atomic<long long> next_block(0);
+
+	vector<thread> threads;
+	for (int t=0; t<thread_count; t++) {
+		threads.push_back(thread([&, t]() {
+			try {
+				long long block;
+				while ((block = next_block++) < num_blocks) {
+					long long begin = block * block_size;
+					long long end = min(begin + block_size, source.dim_source);
+					blocks[(size_t)block].Reset(source.dim_target);
+					ComputeColumns(blocks[(size_t)block], source, caches[t], begin, end);
+				}
+			} catch (...) {
+				errors[t] = current_exception();
+				next_block = num_blocks;
+			}
+		}));
+	}
+	for (int t=0; t<thread_count; t++) {
+		threads[t].join();
+	}
+	for (int t=0; t<thread_count; t++) {
+		if (errors[t]) {
+			rethrow_exception(errors[t]);
+		}
+	}
+
+	for (long long block=0; block<num_blocks; block++) {
+		differential_matrix.AppendColumns(blocks[(size_t)block]);
+		blocks[(size_t)block].Clear();
+	}
+}
+
+void Differential::ComputeDifferentialMatrix(SparseMatrix &differential_matrix, const OrderedBasis &source, const OrderedBasis &target)
+{
+	// Index the target basis once, it is then shared by every column of the matrix
+	IndexedBasis indexed_target(target);
+	ComputeDifferentialMatrix(differential_matrix, source, indexed_target);
+}
+
+void Differential::ComputeDifferentialMatrix(SparseMatrix &differential_matrix, const OrderedBasis &source, const IndexedBasis &target)
+{
+	PROFILE_SCOPE(PHASE_ASSEMBLY);
+	ColumnSource columns;
+	columns.source = &source;
+	columns.target = &target;
+	columns.ranker = 0;
+	columns.dim_source = (long long)source.size();
+	columns.dim_target = target.GetSize();
+	ComputeDifferentialMatrix(differential_matrix, columns);
+	PROFILE_COUNT(PHASE_ASSEMBLY, differential_matrix.GetCols());
+	PROFILE_MATRIX(differential_matrix);
+}
+
+void Differential::ComputeDifferentialMatrix(SparseMatrix &differential_matrix, BasisIterator &source, const BasisRanker &target)
+{
+	differential_matrix.Reset(target.GetDimension(source.GetDegree()+1));
+	ComputeDifferentialMatrix([&differential_matrix](const SparseMatrix &columns) { differential_matrix.AppendColumns(columns); }, source, target);
+	PROFILE_MATRIX(differential_matrix);
+}
+
+void Differential::ComputeDifferentialMatrix(const function<void (const SparseMatrix &)> &append, BasisIterator &source, const BasisRanker &target)
+{
+	PROFILE_SCOPE(PHASE_ASSEMBLY);
+	long long dim_target = target.GetDimension(source.GetDegree()+1);
+	assert(dim_target > 0);
+
+	// The source basis is read one chunk at a time, and each chunk is shared by all the threads
+	const size_t chunk_size = 1024 * thread_count;
+	OrderedBasis chunk;
+	SparseMatrix columns;
+	long long num_columns = 0;
+	source.Reset();
+	PROFILE_TIMER(enumeration);
+	PROFILE_START(enumeration);
+	while (source.NextChunk(chunk, chunk_size) > 0) {
+		PROFILE_STOP(enumeration);
+		PROFILE_COUNT(PHASE_ENUMERATION, (long long)chunk.size());
+		ColumnSource chunk_columns;
+		chunk_columns.source = &chunk;
+		chunk_columns.target = 0;
+		chunk_columns.ranker = &target;
+		chunk_columns.dim_source = (long long)chunk.size();
+		chunk_columns.dim_target = dim_target;
+		ComputeDifferentialMatrix(columns, chunk_columns);
+		append(columns);
+		num_columns += columns.GetCols();
+		PROFILE_START(enumeration);
+	}
+	PROFILE_STOP(enumeration);
+	PROFILE_ADD_TIMER(PHASE_ENUMERATION, enumeration);
+	PROFILE_COUNT(PHASE_ASSEMBLY, num_columns);
 }
 
 
@@ -990,7 +1805,7 @@ istream& operator>>(istream &stream, Word &word)
 		factor = trim(factor);
 		int pos = factor.find("^");
 		if (pos == string::npos) {
-			word.AddPowerOfGenerator(factor, GradedVectorSpace::GetGeneratorDegree(factor), 1);
+			word.AddPowerOfGenerator(factor, 1);
 		} else {
 			stringstream ss(trim(factor.substr(pos+1)));
 			int power;
@@ -1000,7 +1815,7 @@ istream& operator>>(istream &stream, Word &word)
 				return linestream;
 			}
 			string label = trim(factor.substr(0, pos));
-			word.AddPowerOfGenerator(label, GradedVectorSpace::GetGeneratorDegree(label), power);
+			word.AddPowerOfGenerator(label, power);
 		}
 	}
 	return stream;
@@ -1072,8 +1887,8 @@ istream& operator>>(istream &stream, LinearCombination &lc)
 
 		string str = line.substr(term_pos, next_term_pos-term_pos);
 
-		int coeff;
-		Word word;
+		Coefficient coeff;
+		Word word(lc.GetGeneratorRegistry());
 		stringstream str_word;
 
 		if (str.compare(0, 1, "-") == 0) {
@@ -1089,7 +1904,7 @@ istream& operator>>(istream &stream, LinearCombination &lc)
 				begin_pos = 1;
 			size_t pos = str.find_first_of(")");
 			stringstream ss(str.substr(begin_pos+1, pos-(begin_pos+1)));
-			int tmp;
+			Coefficient tmp;
 			if (!(ss >> tmp)) {
 				// Failed to read a coefficient
 				cerr << "Could not read a a coefficient ('" << ss.str() << "') in a linear combination." << endl;
@@ -1133,16 +1948,28 @@ enum INPUT_STAGE
 	NONE, GENERATORS, EXTENSION, DIFFERENTIAL, OUTPUT
 };
 
-bool ReadInputFromFile(const string &filename, string &output_filename, string &extension_output_filename, FreeCGA &cdga, Differential &differential, int &homology_degree_start, int &homology_degree_end, int &category)
+OutputOptions::OutputOptions()
+{
+	category = -1; // By default, the category will be set to -1, so words of length 0 and up (i.e. everything) will be considered
+	homology_degree_start = -1;
+	homology_degree_end = -1;
+	compute = COMPUTE_EXTENSION;
+	matrix_format = MATRIX_BINARY;
+	detect_grading = true;
+	threads = 1;
+	memory_budget = 0;
+}
+
+bool ReadInputFromFile(const string &filename, FreeCGA &cdga, Differential &differential, OutputOptions &options)
 {
 	string line;
 	ifstream file(filename);
-	GradedVectorSpace X;
 	int line_number = 0;
 
-	category = -1; // By default, the category will be set to -1, so words of length 0 and up (i.e. everything) will be considered
-	homology_degree_start = -1;
-	homology_degree_end = -1;
+	// Every file describes a new model, with a registry of its own
+	cdga = FreeCGA();
+	differential.SetGeneratorRegistry(cdga.GetGeneratorRegistry());
+	options = OutputOptions();
 
 	if (file.is_open()) {
 		INPUT_STAGE stage = NONE;
@@ -1166,7 +1993,7 @@ bool ReadInputFromFile(const string &filename, string &output_filename, string &
 				switch (stage) {
 				case GENERATORS:
 					if (ssline >> g) {
-						X.AddGenerator(g.label, g.degree);
+						cdga.AddGenerator(g.label, g.degree);
 					} else {
 						cerr << "Couldn't read generator on line " << line_number << "." << endl;
 						return false;
@@ -1186,7 +2013,7 @@ bool ReadInputFromFile(const string &filename, string &output_filename, string &
 						if (pos != string::npos) {
 							string generator_label = trim(line.substr(2, pos-2));
 							string str_diff;
-							LinearCombination lc;
+							LinearCombination lc(&cdga.GetGeneratorRegistry());
 							pos = line.find_first_of("=");
 							str_diff = trim(line.substr(pos+1));
 							stringstream ss(str_diff);
@@ -1206,33 +2033,92 @@ bool ReadInputFromFile(const string &filename, string &output_filename, string &
 						if (range_pos != string::npos) {
 							stringstream deg_start(trim(line.substr(pos+1, range_pos-(pos+1))));
 							stringstream deg_end(trim(line.substr(range_pos+2)));
-							if (!(deg_start >> homology_degree_start)) {
+							if (!(deg_start >> options.homology_degree_start)) {
 								cerr << "'Start of range degree 'for computation of a basis in homology invalid." << endl;
 								return false;
 							}
-							if (!(deg_end >> homology_degree_end)) {
+							if (!(deg_end >> options.homology_degree_end)) {
 								cerr << "'End of range degree' for computation of a basis in homology invalid." << endl;
 								return false;
 							}
-						} else if (!(ss >> homology_degree_start)) {
+						} else if (!(ss >> options.homology_degree_start)) {
 							cerr << "Degree for computation of a basis in homology invalid." << endl;
 							return false;
 						}
 					} else if (line.compare(0, strlen("category"), "category") == 0) {
 						size_t pos = line.find("=");
 						stringstream ss(trim(line.substr(pos+1)));
-						if (!(ss >> category)) {
+						if (!(ss >> options.category)) {
 							cerr << "The specified category of the space is invalid." << endl;
 							return false;
 						}
 					} else if (line.compare(0, strlen("filename"), "filename") == 0) {
 						size_t pos = line.find("=");
 						stringstream ss(trim(line.substr(pos+1)));
-						ss >> output_filename;
+						ss >> options.output_filename;
 					} else if (line.compare(0, strlen("extension-output"), "extension-output") == 0) {
 						size_t pos = line.find("=");
 						stringstream ss(trim(line.substr(pos+1)));
-						ss >> extension_output_filename;
+						ss >> options.extension_output_filename;
+					} else if (line.compare(0, strlen("checkpoint"), "checkpoint") == 0) {
+						size_t pos = line.find("=");
+						stringstream ss(trim(line.substr(pos+1)));
+						ss >> options.checkpoint_filename;
+					} else if (line.compare(0, strlen("threads"), "threads") == 0) {
+						size_t pos = line.find("=");
+						stringstream ss(trim(line.substr(pos+1)));
+						if (!(ss >> options.threads) || options.threads < 0) {
+							cerr << "The specified number of threads is invalid." << endl;
+							return false;
+						}
+					} else if (line.compare(0, strlen("memory"), "memory") == 0) {
+						size_t pos = line.find("=");
+						stringstream ss(trim(line.substr(pos+1)));
+						if (!(ss >> options.memory_budget) || options.memory_budget < 0) {
+							cerr << "The specified memory budget is invalid." << endl;
+							return false;
+						}
+					} else if (line.compare(0, strlen("matrix-format"), "matrix-format") == 0) {
+						size_t pos = line.find("=");
+						string format = trim(line.substr(pos+1));
+						if (caseInsensitiveStringCompare(format, "binary")) {
+							options.matrix_format = MATRIX_BINARY;
+						} else if (caseInsensitiveStringCompare(format, "market")) {
+							options.matrix_format = MATRIX_MARKET;
+						} else {
+							cerr << "Unknown matrix format '" << format << "' on line " << line_number << "." << endl;
+							return false;
+						}
+					} else if (line.compare(0, strlen("grading"), "grading") == 0) {
+						size_t pos = line.find("=");
+						string grading = trim(line.substr(pos+1));
+						if (caseInsensitiveStringCompare(grading, "auto")) {
+							options.detect_grading = true;
+						} else if (caseInsensitiveStringCompare(grading, "none")) {
+							options.detect_grading = false;
+						} else {
+							cerr << "Unknown grading '" << grading << "' on line " << line_number << "." << endl;
+							return false;
+						}
+					} else if (line.compare(0, strlen("compute"), "compute") == 0) {
+						size_t pos = line.find("=");
+						string mode = trim(line.substr(pos+1));
+						if (caseInsensitiveStringCompare(mode, "extension")) {
+							options.compute = COMPUTE_EXTENSION;
+						} else if (caseInsensitiveStringCompare(mode, "betti")) {
+							options.compute = COMPUTE_BETTI;
+						} else if (caseInsensitiveStringCompare(mode, "plan")) {
+							options.compute = COMPUTE_PLAN;
+						} else if (caseInsensitiveStringCompare(mode, "pipeline")) {
+							options.compute = COMPUTE_PIPELINE;
+						} else if (caseInsensitiveStringCompare(mode, "matrices")) {
+							options.compute = COMPUTE_MATRICES;
+						} else if (caseInsensitiveStringCompare(mode, "spectral")) {
+							options.compute = COMPUTE_SPECTRAL;
+						} else {
+							cerr << "Unknown computation '" << mode << "' on line " << line_number << "." << endl;
+							return false;
+						}
 					}
 					break;
 				};
@@ -1242,8 +2128,7 @@ bool ReadInputFromFile(const string &filename, string &output_filename, string &
 		cerr << "Unable to open file '" << filename << "'." << endl;
 		return false;
 	}
-	cdga.SetGradedVectorSpace(X);
-	if (homology_degree_start < 0) {
+	if (options.homology_degree_start < 0) {
 		cerr << "Degree for computation of a basis in homology not specified or invalid." << endl;
 		return false;
 	}
@@ -4,15 +4,26 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <functional>
+
+#include "sparse.h"
+#include "coefficient.h"
+#include "pool.h"
 
 using namespace std;
 
 bool isEven(int n);
 
 class FreeCGA;
+class BasisRanker;
+class BasisIterator;
+class GeneratorRegistry;
 
 // A generator is a pair consisting of a label and the degree of the generator
 // This label must be unique for each generator
+// Once a generator has been registered, it also carries the integer ID assigned to its label by the GeneratorRegistry
+// of its model, and a pointer to that registry
 class Generator
 {
 public:
@@ -20,44 +31,85 @@ public:
 	{
 		label = "Unitialized";
 		degree = 0;
+		id = -1;
+		registry = 0;
 	}
 	Generator(string _label, int _degree)
 	{
 		label = _label;
 		degree = _degree;
+		id = -1;
+		registry = 0;
 	}
 	string label;
 	int degree;
+	int id;
+	const GeneratorRegistry *registry;
 };
 
-// A structure needed only by the Word class
-class GenPower
+// The registry interns generator labels to dense integer IDs (0, 1, 2, ...), and keeps the degree and the parity of
+// each generator in flat arrays indexed by ID.
+// Every generator also receives a "slot", which is its index among the generators of the same parity. Words store
+// the exponents of even generators and the presence of odd generators by slot.
+// Factors of a word are always kept in the "canonical lexicographical" ordering of their labels, so the registry also
+// keeps, for each odd generator, a bitmask of the odd slots whose label comes first. The Koszul sign of a product of
+// words is then obtained by counting bits.
+// Each model (a FreeCGA with its extension) owns its own registry, so several models can live in one process. A registry
+// is filled while its model is built and only read afterwards: the const methods can then be called from any number of
+// threads, but Intern must not run while another thread uses the registry.
+class GeneratorRegistry
 {
 public:
-	GenPower()
-	{
-		degree = 0;
-		power = 0;
-	}
-	GenPower(int _degree, int _power)
-	{
-		degree = _degree;
-		power = _power;
-	}
-	int degree;
-	int power;
+	GeneratorRegistry();
+
+	// Register a new generator and return its ID. Throws if the label already exists.
+	int Intern(const string &label, int degree);
+	// Return the ID of the generator with name "label", or -1 if there is none
+	int Find(const string &label) const;
+
+	const Generator &GetGenerator(int id) const { return generators[id]; }
+	int GetDegree(int id) const { return degrees[id]; }
+	bool IsEven(int id) const { return even[id] != 0; }
+	int GetSlot(int id) const { return slots[id]; }
+	int GetEvenGenerator(int slot) const { return even_ids[slot]; } // Return the ID of the even generator in a given slot
+	int GetOddGenerator(int slot) const { return odd_ids[slot]; } // Return the ID of the odd generator in a given slot
+	int GetLexicographicRank(int id) const { return lex_ranks[id]; }
+	// Bitmask of the odd slots whose label precedes the label of the odd generator in slot "slot"
+	const vector<unsigned long long> &GetOddPredecessors(int slot) const { return odd_predecessors[slot]; }
+
+	int GetSize() const { return (int)generators.size(); }
+
+private:
+	vector<Generator> generators;
+	vector<int> degrees;
+	vector<char> even;
+	vector<int> slots;
+	vector<int> even_ids;
+	vector<int> odd_ids;
+	vector<int> lex_ranks;
+	vector<vector<unsigned long long> > odd_predecessors;
+	map<string, int> ids;
 };
 
 // A "word" is a concatenation of generators
+// Words are stored as an exponent vector over the even generators together with a bitmask over the odd generators
+// (both indexed by the slots of the GeneratorRegistry). Trailing zeros are never stored, so two words are equal if
+// and only if their arrays are equal. The arrays are stored inline up to 16 even and 128 odd slots, so most words
+// never allocate memory (see SmallArray in pool.h).
+// A word also points to the registry of its model, which must outlive it. A new word takes the registry of the first
+// generator or word it is multiplied with, so the registry only has to be given to find generators by label.
 class Word
 {
 public:
 	Word();
+	explicit Word(const GeneratorRegistry *_registry);
 
-	void Clear();
+	void Clear(); // Make this the empty word, keeping the registry
+	const GeneratorRegistry *GetGeneratorRegistry() const { return registry; }
 
 	// The following two methods should never be used on the "unit" word because it will keep its unit status
-	void AddPowerOfGenerator(const string &label, int deg, int power);
+	// The first one looks up the label in the registry of the word, which must have been given
+	void AddPowerOfGenerator(const string &label, int power);
 	void AddPowerOfGenerator(const Generator &g, int power); 
 	
 	// Note: Multiplication has a rather strange behavior.
@@ -78,35 +130,92 @@ public:
 
 	// Return the first factor of the word as a Generator and return the remaining factors as a Word
 	void GetFirstFactor(Generator &first_factor, Word &remaining_factors) const;
+	// Same as above, but the first factor is returned as the ID of a generator (this must not be called on the unit)
+	int GetFirstFactor(Word &remaining_factors) const;
 
 	static void ConcatenateWords(Word &result, const Word &w1, const Word &w2);
+	// Make this word the product w1 * w2 and return the sign of the product (or 0 if it is zero), like MultiplyOnRight.
+	// The arrays of this word are reused, so no memory is allocated once they are large enough.
+	int SetProduct(const Word &w1, const Word &w2);
 
 	// Check equality of two words
 	bool operator==(const Word &word) const;
+	bool operator!=(const Word &word) const;
+	// An arbitrary (but fixed) total ordering of words, so that words can be used as keys of ordered containers
+	bool operator<(const Word &word) const;
+	size_t Hash() const;
+
+	// Direct access to the factors, by slot of the GeneratorRegistry
+	int GetEvenExponent(int slot) const; // Return the exponent of the even generator in slot "slot"
+	bool HasOddGenerator(int slot) const; // Return true if the odd generator in slot "slot" is a factor
+	int GetEvenSlotCount() const { return (int)exponents.size(); } // All even slots past this one have exponent 0
+	int GetOddSlotCount() const { return (int)odd_mask.size()*64; } // All odd slots past this one are absent
 
 private:
-	map<string, GenPower> generators;
+	void AddPowerOfGenerator(int id, int power);
+	// Return the number of pairs (p, q), with p an odd factor of w1 and q an odd factor of w2, such that q precedes p
+	static int CountOddInversions(const Word &w1, const Word &w2);
+
+	SmallArray<unsigned char, 16> exponents; // Exponents of the even generators, indexed by slot
+	SmallArray<unsigned long long, 2> odd_mask; // Odd generators present in the word, indexed by slot
+	const GeneratorRegistry *registry; // 0 until the word gets its first factor
 	int degree;
+	int length;
 	bool isUnit;
 };
 
+// Use this as the hash function of unordered containers of words
+struct WordHash
+{
+	size_t operator()(const Word &word) const { return word.Hash(); }
+};
+
 typedef vector<Word> OrderedBasis;
 
+// An ordered basis together with a hash index mapping each word to its position in the basis.
+// The index only keeps a pointer to the ordered basis, which must therefore outlive the IndexedBasis object.
+// It is meant to be built once per degree and then shared by every lookup in that degree.
+class IndexedBasis
+{
+public:
+	IndexedBasis();
+	IndexedBasis(const OrderedBasis &_basis);
+
+	void SetBasis(const OrderedBasis &_basis);
+	const OrderedBasis &GetBasis() const;
+	int GetSize() const;
+	const Word &operator[](int i) const;
+
+	// Return the position of "word" in the basis, or -1 if the word is not part of the basis
+	int GetIndex(const Word &word) const;
+
+private:
+	const OrderedBasis *basis;
+	// Open addressing hash table holding positions in "basis" (-1 marks an empty bucket)
+	vector<int> buckets;
+	size_t mask;
+};
+
 class Term
 {
 public:
-	int coeff;
+	Coefficient coeff;
 	Word word;
 };
 
 class LinearCombination
 {
+	friend class Differential;
 public:
 	LinearCombination();
+	// The registry is only used to read the labels of the words of a linear combination (see operator>>)
+	explicit LinearCombination(const GeneratorRegistry *_registry);
+	const GeneratorRegistry *GetGeneratorRegistry() const { return registry; }
+	const vector<Term> &GetTerms() const { return terms; }
 
-	void AddTerm(int coeff, const Word &word);
+	void AddTerm(const Coefficient &coeff, const Word &word);
 	void AddTerms(const LinearCombination &lc);
-	void ScalarMultiply(int coeff);
+	void ScalarMultiply(const Coefficient &coeff);
 	void MultiplyOnLeft(const Generator &g);
 	void MultiplyOnLeft(const Word &word);
 	void MultiplyOnRight(const Generator &g);
@@ -114,39 +223,54 @@ public:
 	void MakeZero();
 	
 	// This method returns the coordinates of a vector (a linear combination) in terms of a certain ordered basis
-	// The pointer "coordinates" must point to an array of the proper size, that is its size must be the number of
-	// elements in the basis.
-	void GetCoordinates(int *coordinates, const OrderedBasis &basis) const;
+	// The vector "coordinates" is resized to the number of elements in the basis.
+	void GetCoordinates(vector<Coefficient> &coordinates, const OrderedBasis &basis) const;
+	void GetCoordinates(vector<Coefficient> &coordinates, const IndexedBasis &basis) const;
+	// Same as above, but only the non-zero coordinates are returned, as a normalized sparse vector
+	void GetCoordinates(CoefficientVector &coordinates, const IndexedBasis &basis) const;
+	// Same as above, for the basis of a given degree described by a BasisRanker (see ranking.h)
+	void GetCoordinates(CoefficientVector &coordinates, const BasisRanker &basis, int degree) const;
 
 	void Simplify(); // Combine all repeated terms in a single term and sum the respective coefficients
 	string OutputString() const; // Output a string representing the linear combination (this will not "simplify" the string first)
 
 private:
 	vector<Term> terms;
+	const GeneratorRegistry *registry;
 };
 
 istream& operator>>(istream&, LinearCombination&);
 ostream& operator<<(ostream&, const LinearCombination&); 
 
 // A graded vector space is created by specifying a basis of generators
+// The generators are registered in a GeneratorRegistry, which is shared by the copies of the vector space and by the
+// other vector spaces of the same model (see FreeCGA)
 class GradedVectorSpace
 {
 	friend FreeCGA;
 public:
-	GradedVectorSpace();
+	GradedVectorSpace(); // An empty vector space with a new registry
 	GradedVectorSpace(const vector<Generator> &_basis);
 
 	void AddGenerator(const string &label, int degree);
-	static int GetGeneratorDegree(const string &label); // Return the degree of the unique generator with name "label"
-	vector<vector<Generator> > GetDegreeIndexedBasis(); // Return a basis ordered by degree
+	int GetGeneratorDegree(const string &label) const; // Return the degree of the unique generator with name "label"
+	const GeneratorRegistry &GetGeneratorRegistry() const { return *registry; }
+	vector<vector<Generator> > GetDegreeIndexedBasis() const; // Return a basis ordered by degree
+	vector<Generator> GetBasis() const; // Return the generators in the order in which they were added
+	int GetDimension() const { return (int)(even_basis.size() + odd_basis.size()); }
+	const vector<Generator> &GetEvenBasis() const { return even_basis; }
+	const vector<Generator> &GetOddBasis() const { return odd_basis; }
+	// Return the smallest degree of a generator, or 0 if there is none. The words of a degree of /\X are only finitely
+	// many if every generator has a positive degree, so this throws a logic_error otherwise.
+	int GetMinimalDegree() const;
 
 private:
 	int maxDegree;
 	vector<Generator> even_basis;
 	vector<Generator> odd_basis;
 
-	// This list maps unique generator labels to their degree
-	static map<string, int> globalGeneratorsList;
+	// This list maps unique generator labels to their ID and degree
+	shared_ptr<GeneratorRegistry> registry;
 };
 
 typedef vector<LinearCombination> OrderedLCBasis;
@@ -156,28 +280,47 @@ typedef vector<LinearCombination> OrderedLCBasis;
 //    /\X (+) (/\X (x) T
 // where (+) stands for the direct sum, (x) stands for the tensor product, and T is a graded module
 // Note: Objects of type vector<OrderedBasis> are simply an array of ordered bases in each degree, indexed by the degree
+// X and T share the generator registry of the model, so the labels of their generators must be distinct.
 class FreeCGA
 {
 public:
 	FreeCGA();
 	FreeCGA(const GradedVectorSpace &_X);
 
+	// Note: This removes the generators of T, which must be added again to the registry of the new X
 	void SetGradedVectorSpace(const GradedVectorSpace &_X);
+	const GradedVectorSpace &GetGradedVectorSpace() const { return X; }
+	const GradedVectorSpace &GetExtensionSpace() const { return T; }
+	const GeneratorRegistry &GetGeneratorRegistry() const { return X.GetGeneratorRegistry(); }
 
 	void GetBasis(vector<OrderedBasis> &basis, int degree, int minLength = 0);
 
-	// This method returns an ordered basis in a given degree on /\^{>=n}X, it is indexed by degree
+	// This method returns an ordered basis on /\^{>=n}X in degrees 0 to "degree"+1, it is indexed by degree
 	// That is, it will return only words of length greater or equal to "minLength"
 	void GetDegreeIndexedBasis(vector<OrderedBasis> &basis, int degree, int minLength = 0);
 	
-	// This method returns an ordered basis in a given degree on /\^{>=n}X (+) (/\^{+}X (x) T), it is indexed by degree
+	// This method returns an ordered basis on /\^{>=n}X (+) (/\^{+}X (x) T) in degrees 0 to "degree"+1, it is indexed by degree
 	// That is, it will return only words of length greater or equal to "minLength" in /\X and it will return all words
 	// consisting of at least one factor in X and exactly one factor in T
 	void GetDegreeIndexedBasisExtended(vector<OrderedBasis> &basis, int degree, int minLength);
 
+	// Same as the two methods above, but only the words of a single degree are enumerated (see BasisIterator in
+	// enumeration.h to list them one at a time instead)
+	void GetBasisInDegree(OrderedBasis &basis, int degree, int minLength = 0) const;
+	void GetBasisInDegreeExtended(OrderedBasis &basis, int degree, int minLength) const;
+
+	// The words x * t of the extended bases are grouped by generator t, in the order in which the generators were added
+	// to T. Adding a generator to T thus only appends words at the end of the bases: this method appends to "basis"
+	// the words x * t of the generators of T which come after the first "first_generator" ones, so that the result is
+	// the basis that would be enumerated now. The indices of the words already in "basis" don't change, so the
+	// matrices and the reductions computed for them stay valid.
+	void ExtendBasisInDegree(OrderedBasis &basis, int degree, int first_generator) const;
+
 	// This method returns an ordered basis in a given degree on /\X, it is indexed by word length
 	void GetLengthIndexedBasis(vector<OrderedBasis> &basis, int degree);
 
+	// This adds a generator to the vector space X
+	void AddGenerator(const string &label, int degree);
 	// This adds a generator to the vector space T
 	void AddExtensionGenerator(string label, int degree);
 
@@ -190,6 +333,50 @@ private:
 	GradedVectorSpace T;
 };
 
+// The differentials of the words met so far by a Differential. Every word gets an ID, and the differential of a word
+// is only computed once, as a sparse vector over word IDs. A cache must never be used by two threads at the same time.
+// The words are indexed by an open addressing hash table (like IndexedBasis) and the differentials are stored back to
+// back in a ListPool, so adding a word to the cache doesn't allocate memory on its own, and Clear releases everything
+// at once.
+class DifferentialCache
+{
+public:
+	DifferentialCache();
+
+	// Return the ID of a word, giving it a new ID if it has never been seen
+	int GetWordID(const Word &word);
+	const Word &GetWord(int id) const { return words[id]; }
+
+	// Return true if the differential of the word with ID "id" has been stored, or found to be large
+	bool IsCached(int id) const { return differential_lists[id] != -1; }
+	// Store the differential of the word with ID "id", which must be normalized (see NormalizeSparseVector)
+	void SetDifferential(int id, const SparseVector &d);
+	// Record that the differential of the word with ID "id" has a coefficient which doesn't fit in 64 bits. It isn't
+	// stored, and is evaluated with Coefficients instead (see Differential::EvaluateLargeDifferential).
+	void SetLarge(int id) { differential_lists[id] = -2; }
+	bool IsLarge(int id) const { return differential_lists[id] == -2; }
+	// The entries of the differential of the word with ID "id", which must have been stored. The pointers are only
+	// valid until the next call to SetDifferential.
+	const SparseVector::value_type *DifferentialBegin(int id) const { return differentials.Begin(differential_lists[id]); }
+	const SparseVector::value_type *DifferentialEnd(int id) const { return differentials.End(differential_lists[id]); }
+
+	// Free the memory used by the cache
+	void Clear();
+
+	Word product; // Used to multiply words without allocating memory
+	SparseVector terms; // Used to build a differential without allocating memory
+
+private:
+	// Double the number of buckets and insert every word again
+	void Rehash();
+
+	vector<Word> words;
+	vector<int> buckets; // Word IDs, or -1 for an empty bucket
+	size_t mask;
+	vector<int> differential_lists; // Index in "differentials" of the differential of each word, or -1, or -2 if it is large
+	ListPool<SparseVector::value_type> differentials;
+};
+
 class Differential
 {
 public:
@@ -199,19 +386,82 @@ public:
 	void SetDifferential(const string &generator_label, const LinearCombination &a);
 	// Define the differential of a generator to be zero
 	void SetDifferentialToZero(const string &generator_label);
+	// Return the number of terms of the differential of a generator (0 if it is not defined)
+	int GetTermCount(const string &generator_label) const;
+	// Return the differential of a generator as it was defined, or 0 if it is not defined
+	const LinearCombination *GetDifferential(const string &generator_label) const;
+
+	// Set the registry in which the labels of the generators are looked up, which must be the registry of the model of
+	// the words the differential is evaluated on
+	void SetGeneratorRegistry(const GeneratorRegistry &_registry);
+
+	// Set the number of threads used to compute the columns of a differential matrix. By default there is only one.
+	// The value 0 means one thread per processor.
+	void SetThreadCount(int count);
 
 	// This method computes the differential from a vector space (/\V)^n ---> (/\V)^{n+1}
 	// The argument passed must consist of a basis for (/\V)^n (the source) and a basis for
 	// (/\V)^{n+1} (the target). Assuming that dim (/\V)^n = N and dim (/\V)^{n+1} = M, then
-	// this method returns the differential as a M x N matrix. Therefore, it is necessary to pass
-	// an M x N array as the argument "differential_matrix"
-	void ComputeDifferentialMatrix(int **differential_matrix, const OrderedBasis &source, const OrderedBasis &target);
+	// this method returns the differential as a sparse M x N matrix, built one column at a time.
+	// The columns are split among the threads, and the result does not depend on the number of threads.
+	void ComputeDifferentialMatrix(SparseMatrix &differential_matrix, const OrderedBasis &source, const OrderedBasis &target);
+	void ComputeDifferentialMatrix(SparseMatrix &differential_matrix, const OrderedBasis &source, const IndexedBasis &target);
+	// Same as above, but the words of the source basis are read one chunk at a time from a BasisIterator and the words
+	// of the target basis are ranked by a BasisRanker, so neither basis needs to be stored in memory
+	void ComputeDifferentialMatrix(SparseMatrix &differential_matrix, BasisIterator &source, const BasisRanker &target);
+	// Same as above, but each chunk of columns is handed to "append" as soon as it is computed instead of being kept, so
+	// the matrix is never held in memory (ExportMatrices in main.cpp writes them to a file, see matrixio.h)
+	void ComputeDifferentialMatrix(const function<void (const SparseMatrix &)> &append, BasisIterator &source, const BasisRanker &target);
 	
 	void EvaluateDifferential(LinearCombination &result, const Word & word);
 
+	// Free the memory used by the differentials of words computed so far
+	void ClearCache();
+
 private:
+	// Where the words of the source basis come from and how the coordinates of their differentials are found
+	struct ColumnSource;
+
+	// Called when the differential of a generator changes. The cache is cleared, unless no cached word can contain the
+	// generator.
+	void Invalidate(const string &generator_label);
+	// Convert the differentials of the generators to lists of words, indexed by generator ID
+	void Compile();
+	// Return the ID of a word in "cache", after making sure that its differential has been computed. The word must not
+	// have a factor with a large differential. If the sums of Leibniz' rule don't fit in 64 bits, the differential is
+	// marked as large in the cache instead of being stored (see DifferentialCache::IsLarge).
+	int GetCachedDifferential(DifferentialCache &cache, const Word &word) const;
+	// Return true if a factor of the word is a generator whose differential has large coefficients
+	bool HasLargeFactor(const Word &word) const;
+	// Return true if the differential of a word must be evaluated with Coefficients, because a factor has a large
+	// differential or because it doesn't fit in the 64-bit cache. Otherwise "id" is set to its ID in the cache.
+	bool IsLargeDifferential(DifferentialCache &cache, const Word &word, int &id) const;
+	// Compute the differential of a word for which IsLargeDifferential is true, as a normalized sparse vector over the
+	// word IDs of "cache". The differentials of its other factors are still taken from the cache.
+	void EvaluateLargeDifferential(DifferentialCache &cache, const Word &word, CoefficientVector &d) const;
+	// Compute the columns begin, ..., end-1 of a differential matrix and append them to "columns"
+	void ComputeColumns(SparseMatrix &columns, const ColumnSource &source, DifferentialCache &cache, long long begin, long long end) const;
+	void ComputeDifferentialMatrix(SparseMatrix &differential_matrix, const ColumnSource &source);
 
 	map<string, LinearCombination> differential;
+	const GeneratorRegistry *registry;
+
+	// The compiled form of "differential": for a generator with ID i, generator_words[i] is the word consisting of
+	// that generator alone and generator_differentials[i] is its differential, if defined[i] is true
+	bool compiled;
+	vector<Word> generator_words;
+	vector<vector<Term> > generator_differentials;
+	vector<bool> defined;
+	// The cache stores the differentials of the words with 64-bit coefficients. The words with a factor whose
+	// differential has a coefficient of more than 31 bits are evaluated with Coefficients instead (see
+	// EvaluateLargeDifferential), so that the sums of Leibniz' rule stay far from overflowing in the cache. A word whose
+	// sums overflow all the same is marked as large in the cache and evaluated in the same way.
+	vector<bool> large;
+	bool has_large;
+
+	// One cache per thread. The first one is also used by EvaluateDifferential.
+	int thread_count;
+	vector<DifferentialCache> caches;
 };
 
 
@@ -221,6 +471,7 @@ istream& operator>>(istream &stream, Generator &g);
 ostream& operator<<(ostream &stream, const Generator &g);
 
 // Use this to read or write a word to a file
+// The labels are looked up in the registry of the word (or of the linear combination), which must have been given.
 istream& operator>>(istream &stream, Word &word);
 ostream& operator<<(ostream &stream, const Word &word);
 
@@ -229,8 +480,44 @@ ostream& operator<<(ostream &stream, const Word &word);
 istream& operator>>(istream &stream, LinearCombination &lc);
 ostream& operator<<(ostream &stream, const LinearCombination &lc);
 
+// What the program computes in each degree of the range
+enum COMPUTE_MODE
+{
+	COMPUTE_EXTENSION,	// A basis of cocycles for the homology (this is the default)
+	COMPUTE_BETTI,		// Only the dimension of the homology, using modular ranks
+	COMPUTE_PLAN,		// Only the dimensions of the bases and the estimated cost of the other computations (see planner.h)
+	COMPUTE_PIPELINE,	// Like COMPUTE_EXTENSION, but the homology of each degree is killed before moving on to the next one
+	COMPUTE_MATRICES,	// Only the matrices of the differentials, which are written to files (see matrixio.h)
+	COMPUTE_SPECTRAL	// The pages of the spectral sequence of the word length filtration, and the dimension of the homology (see spectral.h)
+};
+
+// The formats in which the matrices of the differentials can be written to a file (see matrixio.h)
+enum MATRIX_FORMAT
+{
+	MATRIX_BINARY,	// A compact binary layout, which is read in place through a memory mapping (this is the default)
+	MATRIX_MARKET	// The coordinate format of Matrix Market, a text format read by most sparse solvers
+};
+
+// The settings given in the "Output:" section of an input file
+struct OutputOptions
+{
+	OutputOptions();
+
+	string output_filename;
+	string extension_output_filename;
+	string checkpoint_filename; // The results of each degree are saved to this file, and a run resumes from it (see checkpoint.h)
+	int homology_degree_start;
+	int homology_degree_end;
+	int category;
+	COMPUTE_MODE compute;
+	MATRIX_FORMAT matrix_format; // The format of the files written by COMPUTE_MATRICES
+	bool detect_grading; // Split the differentials into the blocks of an extra grading, if there is one (see grading.h)
+	int threads; // Number of threads used to compute the differential matrices (0 means one per processor)
+	double memory_budget; // Runs whose estimated memory exceeds this many megabytes are refused (0 means no limit)
+};
+
 // Return 'true' if the file was parsed successfully.
-// A FreeCGA and a Differential object will be returned.
-bool ReadInputFromFile(const string &filename, string &output_filename, string &extension_output_filename, FreeCGA &cdga, Differential &differential, int &homology_degree_start, int &homology_degree_end, int &category);
+// A FreeCGA and a Differential object will be returned, together with the output settings.
+bool ReadInputFromFile(const string &filename, FreeCGA &cdga, Differential &differential, OutputOptions &options);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,456 @@
+#include "checkpoint.h"
+
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+
+using namespace std;
+
+static const char CHECKPOINT_TAG[8] = { 'C', 'D', 'G', 'A', 'C', 'K', 'P', 'T' };
+static const unsigned int CHECKPOINT_VERSION = 1;
+static const unsigned int BYTE_ORDER_MARK = 0x01020304;
+
+// The header of a checkpoint file
+struct CheckpointHeader
+{
+	char tag[8];
+	unsigned int version;
+	unsigned int byte_order;
+	unsigned long long fingerprint;
+};
+
+// The payload of a record starts with its degree and the offsets of its parts from the start of the payload
+static const unsigned long long PAYLOAD_HEADER_SIZE = 8 + 8*(SECTION_COUNT+1);
+
+// Mark of a coefficient stored as decimal digits (no coefficient stored in a machine word has this value)
+static const long long BIG_COEFFICIENT = -Coefficient::LARGEST - 1;
+
+// 64-bit FNV-1a hash
+static unsigned long long Hash(const char *data, size_t size, unsigned long long hash = 14695981039346656037ULL)
+{
+	for (size_t i=0; i<size; i++) {
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+unsigned long long ComputeModelFingerprint(const FreeCGA &cdga, const Differential &diff, const OutputOptions &options)
+{
+	ostringstream ss;
+	ss << "version " << CHECKPOINT_VERSION << endl;
+	ss << "category " << options.category << endl;
+	ss << "degree " << options.homology_degree_start << endl;
+	ss << "pipeline " << (options.compute == COMPUTE_PIPELINE) << endl;
+	ss << "grading " << options.detect_grading << endl;
+	// The words of a checkpoint refer to the generators by ID, so the IDs are part of the fingerprint
+	vector<Generator> X_basis = cdga.GetGradedVectorSpace().GetBasis();
+	vector<Generator> T_basis = cdga.GetExtensionSpace().GetBasis();
+	vector<Generator> generators(X_basis);
+	generators.insert(generators.end(), T_basis.begin(), T_basis.end());
+	for (size_t i=0; i<generators.size(); i++) {
+		const Generator &g = generators[i];
+		ss << (i < X_basis.size() ? "X " : "T ") << g.id << " " << g.label << " " << g.degree << " d = ";
+		const LinearCombination *d = diff.GetDifferential(g.label);
+		if (d) {
+			ss << d->OutputString();
+		}
+		ss << endl;
+	}
+	string description = ss.str();
+	return Hash(description.data(), description.size());
+}
+
+template<class T>
+static void Put(string &out, T value)
+{
+	out.append((const char *)&value, sizeof(T));
+}
+
+// The factors of a word are found by slot in the registry of the word
+static void PutWord(string &out, const Word &word)
+{
+	if (word.IsUnit()) {
+		Put<int>(out, -1);
+		return;
+	}
+	const GeneratorRegistry &registry = *word.GetGeneratorRegistry();
+	Put<int>(out, 0);
+	size_t count_pos = out.size() - sizeof(int);
+	int count = 0;
+	for (int slot=0; slot<word.GetEvenSlotCount(); slot++) {
+		int power = word.GetEvenExponent(slot);
+		if (power > 0) {
+			Put<int>(out, registry.GetEvenGenerator(slot));
+			Put<int>(out, power);
+			count++;
+		}
+	}
+	for (int slot=0; slot<word.GetOddSlotCount(); slot++) {
+		if (word.HasOddGenerator(slot)) {
+			Put<int>(out, registry.GetOddGenerator(slot));
+			Put<int>(out, 1);
+			count++;
+		}
+	}
+	memcpy(&out[count_pos], &count, sizeof(int));
+}
+
+static void PutCoefficient(string &out, const Coefficient &c)
+{
+	if (c.IsSmall()) {
+		Put<long long>(out, c.GetSmall());
+	} else {
+		string digits = c.ToString();
+		Put<long long>(out, BIG_COEFFICIENT);
+		Put<unsigned long long>(out, digits.size());
+		out.append(digits);
+	}
+}
+
+static void PutLinearCombinations(string &out, const OrderedLCBasis &lcs)
+{
+	Put<unsigned long long>(out, lcs.size());
+	OrderedLCBasis::const_iterator iter;
+	for (iter = lcs.begin(); iter != lcs.end(); iter++) {
+		const vector<Term> &terms = iter->GetTerms();
+		Put<unsigned long long>(out, terms.size());
+		vector<Term>::const_iterator term;
+		for (term = terms.begin(); term != terms.end(); term++) {
+			PutCoefficient(out, term->coeff);
+			PutWord(out, term->word);
+		}
+	}
+}
+
+// Reads the numbers of a part of a record one after the other. The records have been checked when the file was opened,
+// but a record which is inconsistent still doesn't read past its end.
+class Decoder
+{
+public:
+	Decoder(const char *_pos, const char *_end) : pos(_pos), end(_end) {}
+
+	template<class T>
+	T Get()
+	{
+		T value;
+		memcpy(&value, GetBytes(sizeof(T)), sizeof(T));
+		return value;
+	}
+
+	const char *GetBytes(unsigned long long count)
+	{
+		if ((unsigned long long)(end - pos) < count) {
+			throw logic_error("The checkpoint is corrupt.");
+		}
+		const char *bytes = pos;
+		pos += count;
+		return bytes;
+	}
+
+	void GetWord(Word &word, const GeneratorRegistry &registry)
+	{
+		word = Word(&registry);
+		int count = Get<int>();
+		if (count < 0) {
+			word.SetToUnit(true);
+			return;
+		}
+		for (int i=0; i<count; i++) {
+			int id = Get<int>();
+			int power = Get<int>();
+			if (id < 0 || id >= registry.GetSize()) {
+				throw logic_error("The checkpoint refers to a generator which doesn't exist.");
+			}
+			word.AddPowerOfGenerator(registry.GetGenerator(id), power);
+		}
+	}
+
+	void GetCoefficient(Coefficient &c)
+	{
+		long long value = Get<long long>();
+		if (value != BIG_COEFFICIENT) {
+			c = value;
+			return;
+		}
+		unsigned long long size = Get<unsigned long long>();
+		stringstream ss(string(GetBytes(size), (size_t)size));
+		if (!(ss >> c)) {
+			throw logic_error("The checkpoint is corrupt.");
+		}
+	}
+
+	void GetLinearCombinations(OrderedLCBasis &lcs, const GeneratorRegistry &registry)
+	{
+		lcs.clear();
+		unsigned long long count = Get<unsigned long long>();
+		for (unsigned long long i=0; i<count; i++) {
+			lcs.push_back(LinearCombination(&registry));
+			unsigned long long terms = Get<unsigned long long>();
+			Coefficient coeff;
+			Word word;
+			for (unsigned long long j=0; j<terms; j++) {
+				GetCoefficient(coeff);
+				GetWord(word, registry);
+				lcs.back().AddTerm(coeff, word);
+			}
+		}
+	}
+
+private:
+	const char *pos;
+	const char *end;
+};
+
+CheckpointReader::CheckpointReader()
+{
+	data = 0;
+	size = 0;
+	valid_size = 0;
+}
+
+CheckpointReader::~CheckpointReader()
+{
+	Close();
+}
+
+bool CheckpointReader::Open(const string &filename, unsigned long long fingerprint)
+{
+	Close();
+
+	if (!file.Open(filename) || file.GetSize() < sizeof(CheckpointHeader)) {
+		Close();
+		return false;
+	}
+	data = file.GetData();
+	size = file.GetSize();
+
+	CheckpointHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.tag, CHECKPOINT_TAG, sizeof(CHECKPOINT_TAG)) != 0 || header.version != CHECKPOINT_VERSION ||
+		header.byte_order != BYTE_ORDER_MARK || header.fingerprint != fingerprint) {
+		Close();
+		return false;
+	}
+
+	// Keep the records up to the first one which is incomplete or doesn't match its checksum
+	valid_size = sizeof(header);
+	while (size - valid_size >= 2*sizeof(unsigned long long)) {
+		unsigned long long payload_size;
+		memcpy(&payload_size, data + valid_size, sizeof(payload_size));
+		unsigned long long begin = valid_size + sizeof(payload_size);
+		if (payload_size < PAYLOAD_HEADER_SIZE || payload_size > size - begin - sizeof(unsigned long long)) {
+			break;
+		}
+		unsigned long long checksum;
+		memcpy(&checksum, data + begin + payload_size, sizeof(checksum));
+		if (Hash(data + begin, (size_t)payload_size) != checksum) {
+			break;
+		}
+
+		Decoder decoder(data + begin, data + begin + PAYLOAD_HEADER_SIZE);
+		Record record;
+		record.degree = decoder.Get<int>();
+		decoder.Get<int>();
+		bool valid = true;
+		for (int i=0; i<=SECTION_COUNT; i++) {
+			unsigned long long offset = decoder.Get<unsigned long long>();
+			valid = valid && offset >= PAYLOAD_HEADER_SIZE && offset <= payload_size && (i == 0 || begin + offset >= record.sections[i-1]);
+			record.sections[i] = begin + offset;
+		}
+		if (!valid) {
+			break;
+		}
+		records.push_back(record);
+		valid_size = begin + payload_size + sizeof(checksum);
+	}
+	return true;
+}
+
+void CheckpointReader::Close()
+{
+	file.Close();
+	data = 0;
+	size = 0;
+	records.clear();
+	valid_size = 0;
+}
+
+void CheckpointReader::ReadBasis(int record, OrderedBasis &basis, const GeneratorRegistry &registry) const
+{
+	const Record &r = records[record];
+	Decoder decoder(data + r.sections[SECTION_BASIS], data + r.sections[SECTION_BASIS+1]);
+	unsigned long long count = decoder.Get<unsigned long long>();
+	basis.clear();
+	basis.resize((size_t)count);
+	for (unsigned long long i=0; i<count; i++) {
+		decoder.GetWord(basis[(size_t)i], registry);
+	}
+}
+
+void CheckpointReader::ReadMatrix(int record, SparseMatrix &matrix) const
+{
+	const Record &r = records[record];
+	Decoder decoder(data + r.sections[SECTION_MATRIX], data + r.sections[SECTION_MATRIX+1]);
+	long long rows = decoder.Get<long long>();
+	long long cols = decoder.Get<long long>();
+	matrix.Reset(rows);
+	CoefficientVector column;
+	for (long long j=0; j<cols; j++) {
+		long long count = decoder.Get<long long>();
+		column.resize((size_t)count);
+		for (long long k=0; k<count; k++) {
+			column[(size_t)k].first = decoder.Get<long long>();
+			decoder.GetCoefficient(column[(size_t)k].second);
+		}
+		matrix.AppendColumn(column);
+	}
+}
+
+void CheckpointReader::ReadReduction(int record, ReducedDifferential &reduced, const GeneratorRegistry &registry) const
+{
+	const Record &r = records[record];
+	Decoder kernel(data + r.sections[SECTION_KERNEL], data + r.sections[SECTION_KERNEL+1]);
+	kernel.GetLinearCombinations(reduced.kernel, registry);
+
+	Decoder image(data + r.sections[SECTION_IMAGE], data + r.sections[SECTION_IMAGE+1]);
+	unsigned long long count = image.Get<unsigned long long>();
+	reduced.image.clear();
+	reduced.image.resize((size_t)count);
+	for (unsigned long long i=0; i<count; i++) {
+		CoefficientVector &v = reduced.image[(size_t)i];
+		v.resize((size_t)image.Get<unsigned long long>());
+		for (size_t k=0; k<v.size(); k++) {
+			v[k].first = image.Get<long long>();
+			image.GetCoefficient(v[k].second);
+		}
+	}
+}
+
+void CheckpointReader::ReadHomology(int record, OrderedLCBasis &homology, const GeneratorRegistry &registry) const
+{
+	const Record &r = records[record];
+	Decoder decoder(data + r.sections[SECTION_HOMOLOGY], data + r.sections[SECTION_HOMOLOGY+1]);
+	decoder.GetLinearCombinations(homology, registry);
+}
+
+bool CheckpointWriter::Create(const string &filename, unsigned long long fingerprint)
+{
+	Close();
+	file.open(filename, ios::binary | ios::trunc);
+	if (!file.is_open()) {
+		return false;
+	}
+	CheckpointHeader header;
+	memcpy(header.tag, CHECKPOINT_TAG, sizeof(CHECKPOINT_TAG));
+	header.version = CHECKPOINT_VERSION;
+	header.byte_order = BYTE_ORDER_MARK;
+	header.fingerprint = fingerprint;
+	file.write((const char *)&header, sizeof(header));
+	file.flush();
+	if (!file.good()) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool CheckpointWriter::Continue(const string &filename, unsigned long long valid_size)
+{
+	Close();
+	ifstream old_file(filename, ios::binary | ios::ate);
+	if (!old_file.is_open()) {
+		return false;
+	}
+	if ((unsigned long long)old_file.tellg() > valid_size) {
+		// Copy the valid part to a new file, which then replaces the old one
+		string temp_filename = GetTemporaryFilename(filename);
+		ofstream temp_file(temp_filename, ios::binary | ios::trunc);
+		old_file.seekg(0);
+		vector<char> buffer(1 << 20);
+		for (unsigned long long copied = 0; copied < valid_size; ) {
+			size_t count = (size_t)min<unsigned long long>(buffer.size(), valid_size - copied);
+			old_file.read(buffer.data(), count);
+			temp_file.write(buffer.data(), count);
+			copied += count;
+		}
+		old_file.close();
+		temp_file.close();
+		if (temp_file.fail() || !RenameFile(temp_filename, filename)) {
+			remove(temp_filename.c_str());
+			return false;
+		}
+	}
+	old_file.close();
+	file.open(filename, ios::binary | ios::app);
+	return file.is_open();
+}
+
+bool CheckpointWriter::Write(int degree, const OrderedBasis &basis, const SparseMatrix &matrix, const ReducedDifferential &reduced, const OrderedLCBasis &homology)
+{
+	if (!file.is_open()) {
+		return false;
+	}
+	// Leave room for the offsets of the parts, which are filled in at the end
+	unsigned long long sections[SECTION_COUNT+1];
+	payload.clear();
+	Put<int>(payload, degree);
+	Put<int>(payload, 0);
+	payload.resize((size_t)PAYLOAD_HEADER_SIZE);
+
+	sections[SECTION_BASIS] = payload.size();
+	Put<unsigned long long>(payload, basis.size());
+	OrderedBasis::const_iterator word;
+	for (word = basis.begin(); word != basis.end(); word++) {
+		PutWord(payload, *word);
+	}
+
+	sections[SECTION_MATRIX] = payload.size();
+	Put<long long>(payload, matrix.GetRows());
+	Put<long long>(payload, matrix.GetCols());
+	for (long long j=0; j<matrix.GetCols(); j++) {
+		Put<long long>(payload, matrix.ColumnEnd(j) - matrix.ColumnBegin(j));
+		for (long long k=matrix.ColumnBegin(j); k<matrix.ColumnEnd(j); k++) {
+			Put<long long>(payload, matrix.RowIndex(k));
+			PutCoefficient(payload, matrix.GetCoefficient(k));
+		}
+	}
+
+	sections[SECTION_KERNEL] = payload.size();
+	PutLinearCombinations(payload, reduced.kernel);
+
+	sections[SECTION_IMAGE] = payload.size();
+	Put<unsigned long long>(payload, reduced.image.size());
+	vector<CoefficientVector>::const_iterator v;
+	for (v = reduced.image.begin(); v != reduced.image.end(); v++) {
+		Put<unsigned long long>(payload, v->size());
+		CoefficientVector::const_iterator entry;
+		for (entry = v->begin(); entry != v->end(); entry++) {
+			Put<long long>(payload, entry->first);
+			PutCoefficient(payload, entry->second);
+		}
+	}
+
+	sections[SECTION_HOMOLOGY] = payload.size();
+	PutLinearCombinations(payload, homology);
+
+	sections[SECTION_COUNT] = payload.size();
+	memcpy(&payload[8], sections, sizeof(sections));
+
+	unsigned long long payload_size = payload.size();
+	unsigned long long checksum = Hash(payload.data(), payload.size());
+	file.write((const char *)&payload_size, sizeof(payload_size));
+	file.write(payload.data(), payload.size());
+	file.write((const char *)&checksum, sizeof(checksum));
+	file.flush();
+	return file.good();
+}
+
+void CheckpointWriter::Close()
+{
+	if (file.is_open()) {
+		file.close();
+	}
+	file.clear();
+}
@@ -0,0 +1,107 @@
+#ifndef _CHECKPOINT__H
+#define _CHECKPOINT__H
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "cdga.h"
+#include "homology.h"
+#include "fileio.h"
+
+using namespace std;
+
+// A checkpoint holds the results of every degree of a run of "compute = extension" or "compute = pipeline" (see
+// ComputeModel in main.cpp). Each degree is appended to the file as soon as it is done, so that a run which is
+// interrupted can resume at the first degree which is not in the checkpoint instead of starting over.
+//
+// The file is binary and starts with a header: the tag "CDGACKPT", the version of the format, a byte order mark and the
+// fingerprint of the model (see ComputeModelFingerprint). Then comes one record per degree, in increasing order. A record
+// is the size of its payload, the payload and a checksum of the payload. The payload of degree n holds the basis of X^n,
+// the matrix of d_n : X^n ---> X^{n+1}, the kernel and the image of d_n (see ReducedDifferential) and the basis of the
+// homology in degree n, each at an offset given at the start of the payload.
+// The numbers are stored in the byte order of the machine, so the file can be read without decoding every number. A word
+// is stored as the IDs and the exponents of its factors (the IDs are those of the GeneratorRegistry of the model), and a
+// coefficient as a 64-bit integer, or as decimal digits if it doesn't fit.
+// A record which was cut short by a crash doesn't have the right size or checksum, and is dropped together with
+// everything after it.
+
+// The parts of the payload of a record, in the order in which they are stored
+enum CHECKPOINT_SECTION
+{
+	SECTION_BASIS,
+	SECTION_MATRIX,
+	SECTION_KERNEL,
+	SECTION_IMAGE,
+	SECTION_HOMOLOGY,
+	SECTION_COUNT
+};
+
+// Return a hash of everything the results of a run depend on: the generators of the model and their differentials, the
+// category, the first degree, whether the run is a pipeline and whether the differentials are split by an extra grading
+// (which changes the bases of the kernels). The last degree of the range is not part of it, so a checkpoint can be
+// carried on over a longer range.
+unsigned long long ComputeModelFingerprint(const FreeCGA &cdga, const Differential &diff, const OutputOptions &options);
+
+// Reads a checkpoint through a memory mapping. Opening a checkpoint only checks the header and the sizes and checksums
+// of the records, and the parts of a record are decoded when they are asked for.
+class CheckpointReader
+{
+public:
+	CheckpointReader();
+	~CheckpointReader();
+
+	// Map a checkpoint and find its valid records. Returns false if the file doesn't exist, is not a checkpoint of this
+	// version and byte order, or belongs to another model.
+	bool Open(const string &filename, unsigned long long fingerprint);
+	// Unmap the file. This must be done before the file is written again.
+	void Close();
+
+	int GetRecordCount() const { return (int)records.size(); }
+	int GetDegree(int record) const { return records[record].degree; }
+	// The size of the header and of the valid records. Anything after that is dropped.
+	unsigned long long GetValidSize() const { return valid_size; }
+
+	// Decode the parts of a record. The words are built in "registry", which must already hold the generators they
+	// contain. Throws a logic_error if the record refers to a generator which doesn't exist.
+	void ReadBasis(int record, OrderedBasis &basis, const GeneratorRegistry &registry) const;
+	void ReadMatrix(int record, SparseMatrix &matrix) const;
+	void ReadReduction(int record, ReducedDifferential &reduced, const GeneratorRegistry &registry) const;
+	void ReadHomology(int record, OrderedLCBasis &homology, const GeneratorRegistry &registry) const;
+
+private:
+	struct Record
+	{
+		int degree;
+		// The part i of the record is stored from sections[i] to sections[i+1], as offsets in the file
+		unsigned long long sections[SECTION_COUNT+1];
+	};
+
+	MappedFile file;
+	const char *data; // The contents of the file, or 0
+	unsigned long long size;
+	vector<Record> records;
+	unsigned long long valid_size;
+};
+
+// Appends the records of the degrees to a checkpoint
+class CheckpointWriter
+{
+public:
+	// Start a new checkpoint, replacing the file if it exists. Returns false if the file couldn't be created.
+	bool Create(const string &filename, unsigned long long fingerprint);
+	// Carry on a checkpoint whose first "valid_size" bytes are valid (see CheckpointReader::GetValidSize). The rest of the
+	// file is dropped first. Returns false if the file couldn't be opened.
+	bool Continue(const string &filename, unsigned long long valid_size);
+	bool IsOpen() const { return file.is_open(); }
+
+	// Append the record of degree "degree" and flush it to the file. Returns false if it couldn't be written.
+	bool Write(int degree, const OrderedBasis &basis, const SparseMatrix &matrix, const ReducedDifferential &reduced, const OrderedLCBasis &homology);
+	void Close();
+
+private:
+	ofstream file;
+	string payload; // Kept between records, so that its memory is reused
+};
+
+#endif
@@ -0,0 +1,260 @@
+#include "coefficient.h"
+#include <sstream>
+#include <stdexcept>
+#include <cctype>
+#include <algorithm>
+#include <assert.h>
+#include <NTL/ZZ.h>
+
+NTL_CLIENT
+
+// The conversions between long long and ZZ go through 30-bit digits, because NTL only converts from and to "long",
+// which is a 32-bit type with MSVC
+static const int DIGIT_BITS = 30;
+
+static void ConvertToZZ(ZZ &z, long long value)
+{
+	bool negative = value < 0;
+	unsigned long long a = negative ? 0 - (unsigned long long)value : (unsigned long long)value;
+	ZZ base, digit;
+	conv(base, 1L << DIGIT_BITS);
+	clear(z);
+	for (int shift = 2*DIGIT_BITS; shift >= 0; shift -= DIGIT_BITS) {
+		conv(digit, (long)((a >> shift) & ((1ULL << DIGIT_BITS) - 1)));
+		z = z * base + digit;
+	}
+	if (negative)
+		z = -z;
+}
+
+// Return false if |z| > Coefficient::LARGEST
+static bool ConvertFromZZ(long long &value, const ZZ &z)
+{
+	if (NumBits(z) > 63) {
+		return false;
+	}
+	ZZ a = abs(z);
+	ZZ base;
+	conv(base, 1L << DIGIT_BITS);
+	unsigned long long result = 0;
+	for (int shift = 0; !IsZero(a); shift += DIGIT_BITS) {
+		result |= (unsigned long long)to_long(a % base) << shift;
+		a = a / base;
+	}
+	value = sign(z) < 0 ? -(long long)result : (long long)result;
+	return true;
+}
+
+Coefficient::Coefficient(const ZZ &value)
+{
+	big = 0;
+	SetZZ(value);
+}
+
+Coefficient &Coefficient::operator=(const Coefficient &c)
+{
+	if (this != &c) {
+		if (c.big) {
+			if (big) {
+				*big = *c.big;
+			} else {
+				CopyBig(c);
+			}
+		} else if (big) {
+			DeleteBig();
+		}
+		small = c.small;
+	}
+	return *this;
+}
+
+Coefficient &Coefficient::operator=(Coefficient &&c)
+{
+	if (this != &c) {
+		if (big)
+			DeleteBig();
+		small = c.small;
+		big = c.big;
+		c.big = 0;
+	}
+	return *this;
+}
+
+void Coefficient::GetZZ(ZZ &value) const
+{
+	if (big) {
+		value = *big;
+	} else {
+		ConvertToZZ(value, small);
+	}
+}
+
+unsigned long Coefficient::GetBigResidue(unsigned long p) const
+{
+	// The residue has the sign of p
+	return (unsigned long)rem(*big, (long)p);
+}
+
+long Coefficient::GetBitLength() const
+{
+	if (big) {
+		return NumBits(*big);
+	}
+	unsigned long long a = small < 0 ? 0 - (unsigned long long)small : (unsigned long long)small;
+	long bits = 0;
+	for (; a != 0; a >>= 1) {
+		bits++;
+	}
+	return bits;
+}
+
+Coefficient &Coefficient::AddSlow(const Coefficient &c)
+{
+	ZZ a, b;
+	GetZZ(a);
+	c.GetZZ(b);
+	SetZZ(a + b);
+	return *this;
+}
+
+Coefficient &Coefficient::MultiplySlow(const Coefficient &c)
+{
+	if (!big && !c.big) {
+		// Both factors are machine words, so the product fits if |small| <= LARGEST / |c.small|
+		long long a = small < 0 ? -small : small;
+		long long b = c.small < 0 ? -c.small : c.small;
+		if (a == 0 || b <= LARGEST / a) {
+			small *= c.small;
+			return *this;
+		}
+	}
+	ZZ a, b;
+	GetZZ(a);
+	c.GetZZ(b);
+	SetZZ(a * b);
+	return *this;
+}
+
+Coefficient Coefficient::operator-() const
+{
+	if (!big) {
+		return Coefficient(-small);
+	}
+	Coefficient result;
+	result.SetZZ(-*big);
+	return result;
+}
+
+bool Coefficient::EqualsSlow(const Coefficient &c) const
+{
+	// A value is only stored as an NTL integer when it doesn't fit in a machine word
+	if (!big || !c.big) {
+		return false;
+	}
+	return *big == *c.big;
+}
+
+void Coefficient::SetZZ(const ZZ &value)
+{
+	long long v;
+	if (ConvertFromZZ(v, value)) {
+		if (big)
+			DeleteBig();
+		small = v;
+	} else {
+		if (big) {
+			*big = value;
+		} else {
+			big = new ZZ(value);
+		}
+		small = 0;
+	}
+}
+
+void Coefficient::SetBig(long long value)
+{
+	ZZ z;
+	ConvertToZZ(z, value);
+	big = new ZZ(z);
+	small = 0;
+}
+
+void Coefficient::CopyBig(const Coefficient &c)
+{
+	assert(big == 0);
+	big = new ZZ(*c.big);
+}
+
+void Coefficient::DeleteBig()
+{
+	delete big;
+	big = 0;
+}
+
+void Coefficient::ThrowOverflow()
+{
+	throw logic_error("A coefficient doesn't fit in 64 bits.");
+}
+
+string Coefficient::ToString() const
+{
+	stringstream ss;
+	if (big) {
+		ss << *big;
+	} else {
+		ss << small;
+	}
+	return ss.str();
+}
+
+istream& operator>>(istream &stream, Coefficient &c)
+{
+	// Skip the white space, then read the sign and the digits one at a time, so that any number of digits is accepted
+	stream >> ws;
+	bool negative = false;
+	if (stream.peek() == '-' || stream.peek() == '+') {
+		negative = (stream.get() == '-');
+	}
+	if (!isdigit(stream.peek())) {
+		stream.setstate(ios::failbit);
+		return stream;
+	}
+	Coefficient value;
+	while (isdigit(stream.peek())) {
+		value *= 10;
+		value += stream.get() - '0';
+	}
+	c = negative ? -value : value;
+	return stream;
+}
+
+ostream& operator<<(ostream &stream, const Coefficient &c)
+{
+	return stream << c.ToString();
+}
+
+static bool IsBeforeEntry(const pair<long long, Coefficient> &a, const pair<long long, Coefficient> &b)
+{
+	return a.first < b.first;
+}
+
+void NormalizeCoefficientVector(CoefficientVector &v)
+{
+	stable_sort(v.begin(), v.end(), IsBeforeEntry);
+
+	// Combine the coefficients of repeated indices and drop zero coefficients
+	size_t size = 0;
+	for (size_t i=0; i<v.size(); ) {
+		long long index = v[i].first;
+		Coefficient coeff;
+		for ( ; i<v.size() && v[i].first == index; i++) {
+			coeff += v[i].second;
+		}
+		if (!coeff.IsZero()) {
+			v[size].first = index;
+			v[size].second = move(coeff);
+			size++;
+		}
+	}
+	v.resize(size);
+}
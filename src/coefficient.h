@@ -0,0 +1,107 @@
+#ifndef _COEFFICIENT__H
+#define _COEFFICIENT__H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <iostream>
+
+using namespace std;
+
+namespace NTL { class ZZ; }
+
+// An integer coefficient. Almost every coefficient of a differential or of a cocycle is tiny, so a Coefficient is
+// stored in a machine word (a long long) and the arithmetic on two such coefficients is done inline, with a cheap test
+// for overflow. When a result doesn't fit in 64 bits, the coefficient is promoted to a multiprecision NTL integer, and
+// it is demoted again as soon as a result fits. The machine word only holds values in [-LLONG_MAX, LLONG_MAX], so the
+// negation of a machine word never overflows.
+// Note: There is no 128-bit stage in between, since MSVC has no 128-bit integer type.
+class Coefficient
+{
+public:
+	Coefficient() : small(0), big(0) {}
+	Coefficient(long long value) : small(value), big(0) { if (value < -LARGEST) SetBig(value); }
+	Coefficient(const NTL::ZZ &value);
+	Coefficient(const Coefficient &c) : small(c.small), big(0) { if (c.big) CopyBig(c); }
+	Coefficient(Coefficient &&c) : small(c.small), big(c.big) { c.big = 0; }
+	~Coefficient() { if (big) DeleteBig(); }
+
+	Coefficient &operator=(const Coefficient &c);
+	Coefficient &operator=(Coefficient &&c);
+
+	// Return true if the coefficient is stored in a machine word
+	bool IsSmall() const { return big == 0; }
+	// Return the value of a coefficient stored in a machine word. Throws a logic_error if the coefficient is too large.
+	long long GetSmall() const { if (big) ThrowOverflow(); return small; }
+	// Store the value of the coefficient into an NTL integer
+	void GetZZ(NTL::ZZ &value) const;
+	// Return the residue of the coefficient modulo p, in [0, p)
+	unsigned long GetResidue(unsigned long p) const
+	{
+		if (big)
+			return GetBigResidue(p);
+		long long r = small % (long long)p;
+		return (unsigned long)(r < 0 ? r + (long long)p : r);
+	}
+	// Return the number of bits of the absolute value of the coefficient
+	long GetBitLength() const;
+
+	bool IsZero() const { return big == 0 && small == 0; }
+	bool IsOne() const { return big == 0 && small == 1; }
+	bool IsMinusOne() const { return big == 0 && small == -1; }
+
+	Coefficient &operator+=(const Coefficient &c)
+	{
+		// Both terms are at most LARGEST in absolute value, so their sum can't overflow a long long
+		if (!big && !c.big && (small >= 0 ? c.small <= LARGEST - small : c.small >= -LARGEST - small)) {
+			small += c.small;
+			return *this;
+		}
+		return AddSlow(c);
+	}
+	Coefficient &operator*=(const Coefficient &c)
+	{
+		// Two factors of at most 31 bits have a product of at most 62 bits
+		if (!big && !c.big && small == (int)small && c.small == (int)c.small) {
+			small *= c.small;
+			return *this;
+		}
+		return MultiplySlow(c);
+	}
+	Coefficient operator-() const;
+
+	bool operator==(const Coefficient &c) const { return (!big && !c.big) ? small == c.small : EqualsSlow(c); }
+	bool operator!=(const Coefficient &c) const { return !(*this == c); }
+
+	string ToString() const;
+
+	// The largest absolute value of a coefficient stored in a machine word
+	static const long long LARGEST = 0x7fffffffffffffffLL;
+
+private:
+	Coefficient &AddSlow(const Coefficient &c);
+	Coefficient &MultiplySlow(const Coefficient &c);
+	bool EqualsSlow(const Coefficient &c) const;
+	// Store a value as an NTL integer, or in the machine word if it fits
+	void SetZZ(const NTL::ZZ &value);
+	void SetBig(long long value);
+	void CopyBig(const Coefficient &c);
+	void DeleteBig();
+	unsigned long GetBigResidue(unsigned long p) const;
+	static void ThrowOverflow();
+
+	long long small;
+	NTL::ZZ *big; // Only set when the value doesn't fit in the machine word
+};
+
+// A sparse vector whose coefficients can be arbitrarily large (see SparseVector in sparse.h)
+typedef vector<pair<long long, Coefficient> > CoefficientVector;
+
+// Sort the entries of a vector by index, combine repeated indices and remove zero coefficients
+void NormalizeCoefficientVector(CoefficientVector &v);
+
+// Use this to read or write a coefficient. A coefficient is read as an optional sign followed by decimal digits.
+istream& operator>>(istream &stream, Coefficient &c);
+ostream& operator<<(ostream &stream, const Coefficient &c);
+
+#endif
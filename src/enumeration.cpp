@@ -0,0 +1,213 @@
+#include "enumeration.h"
+#include <algorithm>
+#include <assert.h>
+
+using namespace std;
+
+BasisIterator::BasisIterator(const FreeCGA &cdga, int _degree, int _minLength, bool extended)
+{
+	degree = _degree;
+	minLength = max(_minLength, 0); // A negative minimal length has the same effect as 0
+
+	const GeneratorRegistry &registry = cdga.GetGeneratorRegistry();
+	even_basis = cdga.GetGradedVectorSpace().GetEvenBasis();
+	odd_basis = cdga.GetGradedVectorSpace().GetOddBasis();
+	min_degree = cdga.GetGradedVectorSpace().GetMinimalDegree();
+	for (int i=0; i<(int)even_basis.size(); i++) {
+		even_basis[i].id = registry.Find(even_basis[i].label);
+	}
+	for (int i=0; i<(int)odd_basis.size(); i++) {
+		odd_basis[i].id = registry.Find(odd_basis[i].label);
+	}
+	GetSuffixBounds(even_basis, even_min, even_max);
+	GetSuffixBounds(odd_basis, odd_min, odd_max);
+
+	if (extended) {
+		vector<Generator> T_basis = cdga.GetExtensionSpace().GetBasis();
+		vector<Generator>::const_iterator iter;
+		for (iter = T_basis.begin(); iter != T_basis.end(); iter++) {
+			Word word;
+			word.AddPowerOfGenerator(*iter, 1);
+			T_words.push_back(word);
+		}
+	}
+
+	Reset();
+}
+
+void BasisIterator::GetSuffixBounds(const vector<Generator> &generators, vector<int> &min_degrees, vector<int> &max_degrees)
+{
+	int size = (int)generators.size();
+	min_degrees.assign(size+1, 0);
+	max_degrees.assign(size+1, 0);
+	for (int i=size-1; i>=0; i--) {
+		int deg = generators[i].degree;
+		min_degrees[i] = (i == size-1) ? deg : min(deg, min_degrees[i+1]);
+		max_degrees[i] = (i == size-1) ? deg : max(deg, max_degrees[i+1]);
+	}
+}
+
+void BasisIterator::Reset()
+{
+	block = 0;
+	position = 0;
+	StartBlock();
+}
+
+void BasisIterator::StartBlock()
+{
+	if (block == 0) {
+		block_degree = degree;
+		block_minLength = minLength;
+	} else {
+		block_degree = degree - T_words[block-1].GetDegree();
+		block_minLength = 1;
+	}
+	// NextShape starts from the length block_minLength with no odd factors
+	length = block_minLength;
+	odd_length = -1;
+	in_even = false;
+	odd_search.started = false;
+	odd_search.length = 0;
+}
+
+bool BasisIterator::NextShape()
+{
+	if (block_degree < 0) {
+		return false;
+	}
+	// Every factor has degree at least min_degree, which bounds the length of the words
+	int maxLength = min_degree > 0 ? block_degree / min_degree : 0;
+	for (;;) {
+		odd_length++;
+		if (odd_length > length || odd_length > (int)odd_basis.size()) {
+			length++;
+			odd_length = 0;
+		}
+		if (length > maxLength) {
+			return false;
+		}
+		// Words with even factors need at least one even generator
+		if (length - odd_length > 0 && even_basis.empty()) {
+			continue;
+		}
+		odd_search.factors.clear();
+		odd_search.length = odd_length;
+		odd_search.degree = block_degree;
+		odd_search.started = false;
+		return true;
+	}
+}
+
+bool BasisIterator::Advance(FactorSearch &search, const vector<Generator> &generators, const vector<int> &min_degrees, const vector<int> &max_degrees, bool repeat, int low, int high)
+{
+	int size = (int)generators.size();
+	int candidate = 0;
+	if (search.started) {
+		// Resume the search right after the current choice, by replacing its last factor
+		if (search.factors.empty()) {
+			return false;
+		}
+		candidate = search.factors.back() + 1;
+		search.degree += generators[search.factors.back()].degree;
+		search.factors.pop_back();
+	}
+	search.started = true;
+
+	for (;;) {
+		int remaining = search.length - (int)search.factors.size();
+		if (remaining == 0) {
+			if (search.degree >= low && search.degree <= high) {
+				return true;
+			}
+		} else {
+			// The bounds only get tighter as the candidate increases, so if they fail, no later candidate can succeed
+			int j = candidate;
+			if ((repeat ? j < size : j + remaining <= size) && search.degree >= remaining * min_degrees[j] + low && search.degree <= remaining * max_degrees[j] + high) {
+				search.factors.push_back(j);
+				search.degree -= generators[j].degree;
+				candidate = repeat ? j : j+1;
+				continue;
+			}
+		}
+
+		// Go back up one level and try the next factor there
+		if (search.factors.empty()) {
+			return false;
+		}
+		candidate = search.factors.back() + 1;
+		search.degree += generators[search.factors.back()].degree;
+		search.factors.pop_back();
+	}
+}
+
+bool BasisIterator::NextInBlock()
+{
+	for (;;) {
+		if (in_even) {
+			if (Advance(even_search, even_basis, even_min, even_max, true, 0, 0)) {
+				return true;
+			}
+			in_even = false;
+		}
+
+		// The even factors must fit in the degree left by the odd factors
+		int even_length = length - odd_length;
+		int low = even_length > 0 ? even_length * even_min[0] : 0;
+		int high = even_length > 0 ? even_length * even_max[0] : 0;
+		if (odd_length >= 0 && Advance(odd_search, odd_basis, odd_min, odd_max, false, low, high)) {
+			even_search.factors.clear();
+			even_search.length = even_length;
+			even_search.degree = odd_search.degree;
+			even_search.started = false;
+			in_even = true;
+			continue;
+		}
+
+		if (!NextShape()) {
+			return false;
+		}
+	}
+}
+
+bool BasisIterator::Next(Word &word)
+{
+	while (block <= (int)T_words.size()) {
+		if (NextInBlock()) {
+			word.Clear();
+			if (even_search.factors.empty() && odd_search.factors.empty()) {
+				assert(block == 0);
+				word.SetToUnit(true);
+			} else {
+				vector<int>::const_iterator iter;
+				for (iter = even_search.factors.begin(); iter != even_search.factors.end(); iter++) {
+					word.AddPowerOfGenerator(even_basis[*iter], 1);
+				}
+				for (iter = odd_search.factors.begin(); iter != odd_search.factors.end(); iter++) {
+					word.AddPowerOfGenerator(odd_basis[*iter], 1);
+				}
+				if (block > 0) {
+					Word::ConcatenateWords(word, word, T_words[block-1]);
+				}
+			}
+			position++;
+			return true;
+		}
+		block++;
+		if (block <= (int)T_words.size()) {
+			StartBlock();
+		}
+	}
+	return false;
+}
+
+size_t BasisIterator::NextChunk(OrderedBasis &chunk, size_t count)
+{
+	chunk.resize(count);
+	size_t size = 0;
+	while (size < count && Next(chunk[size])) {
+		size++;
+	}
+	chunk.resize(size);
+	return size;
+}
@@ -0,0 +1,76 @@
+#ifndef _ENUMERATION__H
+#define _ENUMERATION__H
+
+#include "cdga.h"
+
+// A BasisIterator lists the words of a single degree of /\^{>=n}X, or of /\^{>=n}X (+) (/\^{+}X (x) T, in the order
+// of FreeCGA::GetDegreeIndexedBasis and FreeCGA::GetDegreeIndexedBasisExtended (see ranking.h).
+//
+// The words are produced by a depth-first search: for a given length and number of odd factors, the odd factors are
+// chosen first and then the even factors, each time by increasing index. A subtree is skipped as soon as its remaining
+// factors can't reach the target degree: r factors taken among the generators from index i on add a degree between r
+// times the smallest and r times the largest of their degrees.
+//
+// The search is resumable: the iterator only stores the factors of the current word, so a basis can be consumed one
+// word or one chunk at a time without ever being stored in memory.
+class BasisIterator
+{
+public:
+	BasisIterator(const FreeCGA &cdga, int degree, int minLength, bool extended);
+
+	// Store the next word into "word" and return true, or return false if every word has been listed
+	bool Next(Word &word);
+	// Replace the content of "chunk" by the next (at most) "count" words and return the number of words
+	size_t NextChunk(OrderedBasis &chunk, size_t count);
+	// Start again from the first word
+	void Reset();
+
+	int GetDegree() const { return degree; }
+	// Return the position in the basis of the word that the next call to Next will return
+	long long GetPosition() const { return position; }
+
+private:
+	// The state of the search for the odd or the even factors of a word
+	struct FactorSearch
+	{
+		vector<int> factors; // Indices of the factors chosen so far
+		int length; // Number of factors to choose
+		int degree; // Degree left once the factors chosen so far are removed
+		bool started;
+	};
+
+	// Move "search" to its next complete choice of factors. When all "length" factors are chosen, the degree left must
+	// lie between "low" and "high". Return false when there is no choice left.
+	bool Advance(FactorSearch &search, const vector<Generator> &generators, const vector<int> &min_degrees, const vector<int> &max_degrees, bool repeat, int low, int high);
+	// Move to the next word in the current block
+	bool NextInBlock();
+	// Move to the next length and number of odd factors in the current block
+	bool NextShape();
+	// Start listing the block of the words of /\^{>=n}X (block 0) or of the words x * t for the generator t = T[block-1]
+	void StartBlock();
+
+	// Fill "min_degrees" and "max_degrees" with the smallest and largest degrees of generators[i], generators[i+1], ...
+	static void GetSuffixBounds(const vector<Generator> &generators, vector<int> &min_degrees, vector<int> &max_degrees);
+
+	int degree;
+	int minLength;
+
+	vector<Generator> even_basis; // X^even
+	vector<Generator> odd_basis; // X^odd
+	vector<Word> T_words; // The generators of T as words, in the order in which they were added to T
+	vector<int> even_min, even_max, odd_min, odd_max;
+	int min_degree; // Smallest degree of a generator of X
+
+	// Current position of the search
+	int block;
+	int block_degree; // Degree of the words of X in the current block
+	int block_minLength;
+	int length;
+	int odd_length;
+	bool in_even; // True when the odd factors are chosen and the search is over the even factors
+	FactorSearch odd_search;
+	FactorSearch even_search;
+	long long position;
+};
+
+#endif
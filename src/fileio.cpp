@@ -0,0 +1,106 @@
+#include "fileio.h"
+
+#include <sstream>
+#include <fstream>
+#include <atomic>
+#include <cstdio>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+bool RenameFile(const string &old_filename, const string &new_filename)
+{
+#ifdef _WIN32
+	// On Windows, rename() fails if the file exists
+	return MoveFileExA(old_filename.c_str(), new_filename.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(old_filename.c_str(), new_filename.c_str()) == 0;
+#endif
+}
+
+string GetTemporaryFilename(const string &filename)
+{
+	static atomic<unsigned long long> count(0);
+	stringstream temp_filename;
+	temp_filename << filename << ".tmp" << count++;
+	return temp_filename.str();
+}
+
+bool WriteFileAtomically(const string &filename, const string &contents)
+{
+	string temp_filename = GetTemporaryFilename(filename);
+	ofstream file(temp_filename);
+	if (!file.is_open()) {
+		return false;
+	}
+	file << contents;
+	file.close();
+	if (file.fail()) {
+		remove(temp_filename.c_str());
+		return false;
+	}
+	bool renamed = RenameFile(temp_filename, filename);
+	if (!renamed) {
+		remove(temp_filename.c_str());
+	}
+	return renamed;
+}
+
+bool MappedFile::Open(const string &filename)
+{
+	Close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER file_size;
+	if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+		// The view keeps the file mapped once the handles are closed
+		HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+		if (mapping) {
+			data = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+		}
+		size = data ? (unsigned long long)file_size.QuadPart : 0;
+	}
+	CloseHandle(file);
+#else
+	int file = open(filename.c_str(), O_RDONLY);
+	if (file < 0) {
+		return false;
+	}
+	struct stat file_stat;
+	if (fstat(file, &file_stat) == 0 && file_stat.st_size > 0) {
+		void *view = mmap(0, (size_t)file_stat.st_size, PROT_READ, MAP_SHARED, file, 0);
+		if (view != MAP_FAILED) {
+			data = (const char *)view;
+			size = (unsigned long long)file_stat.st_size;
+		}
+	}
+	close(file);
+#endif
+	return data != 0;
+}
+
+void MappedFile::Close()
+{
+	if (data) {
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+#else
+		munmap((void *)data, (size_t)size);
+#endif
+	}
+	data = 0;
+	size = 0;
+}
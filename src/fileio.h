@@ -0,0 +1,46 @@
+#ifndef _FILEIO__H
+#define _FILEIO__H
+
+#include <string>
+
+using namespace std;
+
+// The few file operations which differ between Windows and the other systems, and which the results, the checkpoints
+// (see checkpoint.h) and the matrix files (see matrixio.h) are written and read with
+
+// Rename a file, replacing the file "new_filename" if it exists. Returns false if the file couldn't be renamed.
+bool RenameFile(const string &old_filename, const string &new_filename);
+
+// Return the name of a temporary file next to a file. Each call returns a new name, so that two threads writing the same
+// file don't write to the same temporary file.
+string GetTemporaryFilename(const string &filename);
+
+// Write "contents" to a file through a temporary file which is then renamed, so that the file is never left half written
+// (for example by a run which is interrupted). Returns false if the file couldn't be written.
+bool WriteFileAtomically(const string &filename, const string &contents);
+
+// A file mapped read-only in memory, so that its contents can be read in place instead of being parsed into memory
+// first. The pages are only read from the disk when they are used.
+class MappedFile
+{
+public:
+	MappedFile() : data(0), size(0) {}
+	~MappedFile() { Close(); }
+
+	// Map a whole file. Returns false if the file doesn't exist, is empty or can't be mapped.
+	bool Open(const string &filename);
+	void Close();
+
+	bool IsOpen() const { return data != 0; }
+	const char *GetData() const { return data; }
+	unsigned long long GetSize() const { return size; }
+
+private:
+	MappedFile(const MappedFile &);
+	MappedFile &operator=(const MappedFile &);
+
+	const char *data;
+	unsigned long long size;
+};
+
+#endif
@@ -0,0 +1,162 @@
+#include "grading.h"
+
+#include <map>
+#include <NTL/LLL.h>
+
+NTL_CLIENT
+
+ExtraGrading::ExtraGrading()
+{
+}
+
+void ExtraGrading::Clear()
+{
+	weights.clear();
+	shifts.clear();
+}
+
+// Add the exponents of the factors of a word to the coefficients of the weights of their generators
+static void AddExponents(const Word &word, const GeneratorRegistry &registry, vector<long long> &equation)
+{
+	if (word.IsUnit()) {
+		return;
+	}
+	for (int slot=0; slot<word.GetEvenSlotCount(); slot++) {
+		int exponent = word.GetEvenExponent(slot);
+		if (exponent != 0) {
+			equation[registry.GetEvenGenerator(slot)] += exponent;
+		}
+	}
+	for (int slot=0; slot<word.GetOddSlotCount(); slot++) {
+		if (word.HasOddGenerator(slot)) {
+			equation[registry.GetOddGenerator(slot)] += 1;
+		}
+	}
+}
+
+void ExtraGrading::Detect(const FreeCGA &cdga, const Differential &diff)
+{
+	Clear();
+	const GeneratorRegistry &registry = cdga.GetGeneratorRegistry();
+	int num_generators = registry.GetSize();
+	if (num_generators == 0) {
+		return;
+	}
+
+	// The unknowns are the weights of the generators, by ID, followed by the shift. Each term of the differential of a
+	// generator g gives the equation  (sum of the weights of its factors) - w(g) - s = 0.
+	vector<vector<long long> > equations;
+	for (int id=0; id<num_generators; id++) {
+		const LinearCombination *d = diff.GetDifferential(registry.GetGenerator(id).label);
+		if (!d) {
+			continue;
+		}
+		// Terms which cancel out must not constrain the weights
+		LinearCombination simplified(*d);
+		simplified.Simplify();
+		vector<Term>::const_iterator iter;
+		for (iter = simplified.GetTerms().begin(); iter != simplified.GetTerms().end(); iter++) {
+			if (iter->coeff.IsZero()) {
+				continue;
+			}
+			vector<long long> equation(num_generators+1, 0);
+			AddExponents(iter->word, registry, equation);
+			equation[id] -= 1;
+			equation[num_generators] -= 1;
+			equations.push_back(equation);
+		}
+	}
+
+	// The solutions are the integer vectors x with x * D = 0, where the columns of D are the equations. As in
+	// ReduceDifferential, the first rows of U give a reduced basis of them.
+	int num_unknowns = num_generators+1;
+	mat_ZZ D, U;
+	ZZ det;
+	long dim_solutions = num_unknowns;
+	if (equations.empty()) {
+		ident(U, num_unknowns);
+	} else {
+		D.SetDims(num_unknowns, (long)equations.size());
+		for (long j=0; j<(long)equations.size(); j++) {
+			for (int i=0; i<num_unknowns; i++) {
+				if (equations[j][i] != 0) {
+					Coefficient(equations[j][i]).GetZZ(D[i][j]);
+				}
+			}
+		}
+		dim_solutions = num_unknowns - LLL(det, D, U);
+	}
+
+	for (long i=0; i<dim_solutions; i++) {
+		vector<long long> grading(num_generators);
+		bool usable = true;
+		bool zero = true;
+		for (int j=0; j<num_generators && usable; j++) {
+			Coefficient weight(U[i][j]);
+			usable = weight.IsSmall();
+			if (usable) {
+				grading[j] = weight.GetSmall();
+				zero = zero && grading[j] == 0;
+			}
+		}
+		Coefficient shift(U[i][num_generators]);
+		// A grading which is 0 on every generator doesn't split anything, and weights too large to be added up are
+		// simply not used
+		if (!usable || zero || !shift.IsSmall()) {
+			continue;
+		}
+		weights.push_back(grading);
+		shifts.push_back(shift.GetSmall());
+	}
+}
+
+void ExtraGrading::GetWeights(const Word &word, vector<long long> &word_weights) const
+{
+	word_weights.assign(weights.size(), 0);
+	if (word.IsUnit()) {
+		return;
+	}
+	const GeneratorRegistry &registry = *word.GetGeneratorRegistry();
+	for (int slot=0; slot<word.GetEvenSlotCount(); slot++) {
+		int exponent = word.GetEvenExponent(slot);
+		if (exponent == 0) {
+			continue;
+		}
+		int id = registry.GetEvenGenerator(slot);
+		for (size_t r=0; r<weights.size(); r++) {
+			if (id < (int)weights[r].size()) {
+				word_weights[r] += exponent * weights[r][id];
+			}
+		}
+	}
+	for (int slot=0; slot<word.GetOddSlotCount(); slot++) {
+		if (!word.HasOddGenerator(slot)) {
+			continue;
+		}
+		int id = registry.GetOddGenerator(slot);
+		for (size_t r=0; r<weights.size(); r++) {
+			if (id < (int)weights[r].size()) {
+				word_weights[r] += weights[r][id];
+			}
+		}
+	}
+}
+
+void ExtraGrading::SplitBasis(const OrderedBasis &basis, vector<vector<long long> > &block_weights, vector<vector<int> > &blocks) const
+{
+	map<vector<long long>, vector<int> > split;
+	vector<long long> word_weights;
+	for (int i=0; i<(int)basis.size(); i++) {
+		GetWeights(basis[i], word_weights);
+		split[word_weights].push_back(i);
+	}
+
+	block_weights.clear();
+	blocks.clear();
+	map<vector<long long>, vector<int> >::iterator iter;
+	for (iter = split.begin(); iter != split.end(); iter++) {
+		block_weights.push_back(iter->first);
+		blocks.push_back(vector<int>());
+		blocks.back().swap(iter->second);
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef _GRADING__H
+#define _GRADING__H
+
+#include <vector>
+
+#include "cdga.h"
+
+using namespace std;
+
+// Many models carry a second grading which the differential respects: the word length of a model with a quadratic
+// differential, a weight grading, the lower grading of a pure model... Such a grading gives every generator g an
+// integer weight w(g), and the weight of a word is the sum of the weights of its factors (with their exponents). It is
+// respected by the differential if d raises the weight of every generator by the same amount s, that is if every term
+// of d(g) has weight w(g) + s. By Leibniz' rule, d then raises the weight of every word by s, so the matrix of
+// d_n : X^n ---> X^{n+1} is block diagonal: the words of weight k only reach the words of weight k + s, and each block
+// can be reduced on its own (see ReduceDifferential in homology.h).
+//
+// The conditions on the weights and the shift are linear equations with integer coefficients, one per term of the
+// differential of each generator, so the gradings respected by the differential form a lattice. The degree is always in
+// it (with s = 1). A basis of the lattice is found with LLL, and two words are in the same block when they have the same
+// weights for every grading of the basis.
+class ExtraGrading
+{
+public:
+	ExtraGrading();
+
+	// Find the gradings respected by the differentials of the generators of a model. This must be done again when
+	// generators are added to the model or when their differentials change.
+	void Detect(const FreeCGA &cdga, const Differential &diff);
+	// Forget the gradings, so that every basis is a single block
+	void Clear();
+
+	// The number of independent gradings found besides the degree. The bases are only split if it is not 0.
+	int GetCount() const { return weights.empty() ? 0 : (int)weights.size()-1; }
+
+	// Return the weights of a word for each grading of the basis (the unit has weight 0)
+	void GetWeights(const Word &word, vector<long long> &word_weights) const;
+	// The amount by which the differential raises the weights of each grading
+	const vector<long long> &GetShifts() const { return shifts; }
+
+	// Split an ordered basis into blocks of words with the same weights. The blocks are sorted by weights, and each one
+	// lists the positions of its words in the basis in increasing order.
+	void SplitBasis(const OrderedBasis &basis, vector<vector<long long> > &block_weights, vector<vector<int> > &blocks) const;
+
+private:
+	// weights[r][id] is the weight of the generator with ID "id" for the grading r. The weights of the generators which
+	// were registered after the gradings were found are 0.
+	vector<vector<long long> > weights;
+	vector<long long> shifts;
+};
+
+#endif
@@ -1,156 +1,481 @@
 #include "homology.h"
+#include "modular.h"
+#include "ranking.h"
+#include "enumeration.h"
+#include "profile.h"
 
 #include <assert.h>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <exception>
 #include <NTL/LLL.h>
 
 NTL_CLIENT
 
-void FindCocycleBasis(int **differential_matrix, int rows_size, int cols_size, OrderedLCBasis &cocycleBasis, const OrderedBasis &source)
+// NTL only works with dense matrices, so this is where a sparse differential gets expanded.
+// Note: We need D to be the transpose of the differential, because of the "reverse" convention used by NTL.
+// Since the sparse matrix is stored by columns, each column simply becomes a row of D.
+static void GetTransposedDenseMatrix(mat_ZZ &D, const SparseMatrix &m)
+{
+	D.SetDims(m.GetCols(), m.GetRows());
+	for (long long j=0; j<m.GetCols(); j++) {
+		for (long long k=m.ColumnBegin(j); k<m.ColumnEnd(j); k++) {
+			m.GetCoefficient(k).GetZZ(D[j][m.RowIndex(k)]);
+		}
+	}
+}
+
+void ReducedDifferential::Clear()
+{
+	OrderedLCBasis().swap(kernel);
+	vector<CoefficientVector>().swap(image);
+}
+
+void ReducedDifferential::Swap(ReducedDifferential &other)
+{
+	kernel.swap(other.kernel);
+	image.swap(other.image);
+}
+
+void ReduceDifferential(const SparseMatrix &differential_matrix, ReducedDifferential &result, const OrderedBasis &source)
 {
 	mat_ZZ D, U;
 	long rank;
 	ZZ d;
+	int rows_size = (int)differential_matrix.GetRows();
+	int cols_size = (int)differential_matrix.GetCols();
 	
-	// Empty the parameter "cocycleBasis" that was passed
-	cocycleBasis.clear();
+	// Empty the parameter "result" that was passed
+	result.Clear();
 
 	// If the differential is zero, then a basis of cocycles is just the basis of the space that was passed to us
-	if (differential_matrix == 0 || rows_size == 0 || cols_size == 0) {
+	if (rows_size == 0 || cols_size == 0) {
 		OrderedBasis::const_iterator iter;
 		for (iter = source.begin(); iter != source.end(); iter++) {
 			LinearCombination lc;
 			lc.AddTerm(1, *iter);
-			cocycleBasis.push_back(lc);
+			result.kernel.push_back(lc);
 		}
 		return;
 	}
 	
-	// Note: We need D to be the transpose of "differential_matrix", because of the "reverse" convention used by NTL.
-	D.SetDims(cols_size, rows_size);
-	for (int i=0; i<rows_size; i++) {
-		for (int j=0; j<cols_size; j++) {
-			D[j][i] = differential_matrix[i][j];
-		}
-	}
-	
-	cerr << D << endl;
+	GetTransposedDenseMatrix(D, differential_matrix);
 
 	// Use the LLL algorithm to compute the rank of the matrix D.
 	// The first cols_size - rank rows of U will be a basis of the kernel of D.
+	PROFILE_TIMER(kernel);
+	PROFILE_START(kernel);
 	rank = LLL(d, D, U);
 
 	int dim_ker = cols_size - rank;
 
-	// Loop through the first dim_ker rows of U and store the result into cocycleBasis
+	// Loop through the first dim_ker rows of U and store the result into the kernel. The entries of U and D can get
+	// large, so they are kept as coefficients of any size.
 	for (int i=0; i<dim_ker; i++) {
 		LinearCombination lc;
 		for (int j=0; j<cols_size; j++) {
-			assert(NumBits(U[i][j]) < 32);
-			int coeff = to_int(U[i][j]);
-			if (coeff != 0) {
-				lc.AddTerm(coeff, source[j]);
+			if (!IsZero(U[i][j])) {
+				lc.AddTerm(Coefficient(U[i][j]), source[j]);
+				PROFILE_BITS(NumBits(U[i][j]));
+			}
+		}
+		result.kernel.push_back(lc);
+	}
+	PROFILE_STOP(kernel);
+	PROFILE_ADD_TIMER(PHASE_KERNEL, kernel);
+	PROFILE_COUNT(PHASE_KERNEL, dim_ker);
+
+	// The last rank rows of D are now a (reduced) basis of the image, store them into the image
+	PROFILE_SCOPE(PHASE_IMAGE);
+	for (int i=dim_ker; i<cols_size; i++) {
+		CoefficientVector v;
+		for (int j=0; j<rows_size; j++) {
+			if (!IsZero(D[i][j])) {
+				v.push_back(make_pair((long long)j, Coefficient(D[i][j])));
+				PROFILE_BITS(NumBits(D[i][j]));
 			}
 		}
-		cocycleBasis.push_back(lc);
+		result.image.push_back(v);
 	}
+	PROFILE_COUNT(PHASE_IMAGE, rank);
+}
+
+// A block of the matrix of a differential: the columns of the words of the source basis with given weights, and the
+// rows of the words of the target basis with the shifted weights
+struct DifferentialBlock
+{
+	OrderedBasis source;
+	vector<int> rows; // The position in the target basis of each row of the block
+	SparseMatrix matrix;
+	ReducedDifferential reduced;
+};
+
+// The blocks with the most entries in their dense matrix are reduced first, so that the threads finish together
+static bool IsLargerBlock(const DifferentialBlock *b1, const DifferentialBlock *b2)
+{
+	return (long long)b1->source.size() * (long long)b1->rows.size() > (long long)b2->source.size() * (long long)b2->rows.size();
 }
-void GetCoordinates(const LinearCombination &lc, vec_ZZ &coordinates, const OrderedBasis &basis)
+
+void ReduceDifferential(const SparseMatrix &differential_matrix, ReducedDifferential &result, const OrderedBasis &source, const OrderedBasis &target, const ExtraGrading &grading, int threads)
 {
-	if (basis.empty()) {
+	// A zero differential has nothing to split
+	if (grading.GetCount() == 0 || differential_matrix.GetRows() == 0 || differential_matrix.GetCols() == 0) {
+		ReduceDifferential(differential_matrix, result, source);
+		return;
+	}
+	vector<vector<long long> > source_weights, target_weights;
+	vector<vector<int> > source_blocks, target_blocks;
+	grading.SplitBasis(source, source_weights, source_blocks);
+	if (source_blocks.size() == 1) {
+		ReduceDifferential(differential_matrix, result, source);
 		return;
 	}
-	int size = basis.size();
-	int *coords_array = new int[size];
-	lc.GetCoordinates(coords_array, basis);
-	for (int i=0; i<size; i++) {
-		coordinates[i] = coords_array[i];
+	assert((long long)target.size() == differential_matrix.GetRows());
+	grading.SplitBasis(target, target_weights, target_blocks);
+
+	// The block of each row of the matrix and its position in the block
+	vector<int> row_blocks(target.size()), row_positions(target.size());
+	map<vector<long long>, int> target_indices;
+	for (int t=0; t<(int)target_blocks.size(); t++) {
+		target_indices[target_weights[t]] = t;
+		for (int i=0; i<(int)target_blocks[t].size(); i++) {
+			row_blocks[target_blocks[t][i]] = t;
+			row_positions[target_blocks[t][i]] = i;
+		}
+	}
+
+	const vector<long long> &shifts = grading.GetShifts();
+	vector<DifferentialBlock> blocks(source_blocks.size());
+	CoefficientVector column;
+	for (size_t b=0; b<source_blocks.size(); b++) {
+		vector<long long> weights(source_weights[b]);
+		for (size_t r=0; r<weights.size(); r++) {
+			weights[r] += shifts[r];
+		}
+		map<vector<long long>, int>::const_iterator target_block = target_indices.find(weights);
+		int t = (target_block == target_indices.end()) ? -1 : target_block->second;
+
+		DifferentialBlock &block = blocks[b];
+		if (t >= 0) {
+			block.rows = target_blocks[t];
+		}
+		block.matrix.Reset((long long)block.rows.size());
+		vector<int>::const_iterator iter;
+		for (iter = source_blocks[b].begin(); iter != source_blocks[b].end(); iter++) {
+			block.source.push_back(source[*iter]);
+			// The rows of a block are in the order of the target basis, so the column stays sorted
+			column.clear();
+			for (long long k=differential_matrix.ColumnBegin(*iter); k<differential_matrix.ColumnEnd(*iter); k++) {
+				long long i = differential_matrix.RowIndex(k);
+				if (row_blocks[(size_t)i] != t) {
+					throw logic_error("Fatal error. The differential doesn't respect the extra grading.");
+				}
+				column.push_back(make_pair((long long)row_positions[(size_t)i], differential_matrix.GetCoefficient(k)));
+			}
+			block.matrix.AppendColumn(column);
+		}
+	}
+
+	vector<DifferentialBlock *> order;
+	for (size_t b=0; b<blocks.size(); b++) {
+		order.push_back(&blocks[b]);
+	}
+	stable_sort(order.begin(), order.end(), IsLargerBlock);
+
+	// The threads take the blocks in turn. NTL must have been built with NTL_THREADS (the default) for its integers to
+	// be used by several threads.
+	if (threads <= 0) {
+		threads = (int)thread::hardware_concurrency();
+	}
+	threads = max(1, min(threads, (int)order.size()));
+	atomic<size_t> next_block(0);
+	vector<exception_ptr> errors(threads);
+	auto reduce_blocks = [&](int t) {
+		try {
+			size_t b;
+			while ((b = next_block++) < order.size()) {
+				ReduceDifferential(order[b]->matrix, order[b]->reduced, order[b]->source);
+				order[b]->matrix.Clear();
+			}
+		} catch (...) {
+			errors[t] = current_exception();
+			next_block = order.size();
+		}
+	};
+	if (threads == 1) {
+		reduce_blocks(0);
+	} else {
+		vector<thread> workers;
+		for (int t=0; t<threads; t++) {
+			workers.push_back(thread(reduce_blocks, t));
+		}
+		for (int t=0; t<threads; t++) {
+			workers[t].join();
+		}
+	}
+	for (int t=0; t<threads; t++) {
+		if (errors[t]) {
+			rethrow_exception(errors[t]);
+		}
+	}
+
+	// Put the results of the blocks together, with the coordinates of the image in the whole target basis
+	result.Clear();
+	for (size_t b=0; b<blocks.size(); b++) {
+		DifferentialBlock &block = blocks[b];
+		result.kernel.insert(result.kernel.end(), block.reduced.kernel.begin(), block.reduced.kernel.end());
+		vector<CoefficientVector>::iterator iter;
+		for (iter = block.reduced.image.begin(); iter != block.reduced.image.end(); iter++) {
+			CoefficientVector::iterator entry;
+			for (entry = iter->begin(); entry != iter->end(); entry++) {
+				entry->first = block.rows[(size_t)entry->first];
+			}
+			result.image.push_back(CoefficientVector());
+			result.image.back().swap(*iter);
+		}
+		block.reduced.Clear();
 	}
-	delete [] coords_array;
 }
 
-void FindHomologyBasis(int **d1, int d1_rows_size, int d1_cols_size, int **d2, int d2_rows_size, int d2_cols_size, OrderedLCBasis &homologyBasis, OrderedLCBasis &imageBasis, const OrderedBasis &source)
+void FindCocycleBasis(const SparseMatrix &differential_matrix, OrderedLCBasis &cocycleBasis, const OrderedBasis &source)
 {
-	OrderedLCBasis cocyclesBasis;
-
-	// First, find a basis of cocycles
-	FindCocycleBasis(d2, d2_rows_size, d2_cols_size, cocyclesBasis, source);
+	ReducedDifferential result;
+	ReduceDifferential(differential_matrix, result, source);
+	cocycleBasis.swap(result.kernel);
+}
 
-	// If the differential d1 is zero, we are done here, we can return homologyBasis = cocyclesBasis
-	if (d1 == 0 || d1_rows_size == 0 || d1_cols_size == 0) {
-		homologyBasis = cocyclesBasis;
+void GetCoordinates(const LinearCombination &lc, vec_ZZ &coordinates, const IndexedBasis &basis)
+{
+	if (basis.GetSize() == 0) {
 		return;
 	}
+	vector<Coefficient> coords;
+	lc.GetCoordinates(coords, basis);
+	for (int i=0; i<(int)coords.size(); i++) {
+		coords[i].GetZZ(coordinates[i]);
+	}
+}
 
-	mat_ZZ D1;
-	long rank;
-	ZZ d;
+// A row echelon form over the integers, built one row at a time. Rows are reduced with fraction-free elimination
+// (a row is only ever divided by the gcd of its own entries), so all computations stay exact and the entries stay small.
+class RowEchelonForm
+{
+public:
+	RowEchelonForm(long cols) : pivot_rows(cols, -1) {}
 
-	// Note: We need D1 to be the transpose of "d1", because of the "reverse" convention used by NTL.
-	D1.SetDims(d1_cols_size, d1_rows_size);
-	for (int i=0; i<d1_rows_size; i++) {
-		for (int j=0; j<d1_cols_size; j++) {
-			D1[j][i] = d1[i][j];
-		}
+	// Reduce "row" against the rows of the echelon form. If the result is non-zero, the row was not in the span of
+	// the previous rows: it is then added to the echelon form and the method returns true.
+	bool AddRow(vec_ZZ row);
+
+private:
+	static void RemoveContent(vec_ZZ &row, long start);
+
+	vector<vec_ZZ> rows;
+	vector<long> pivot_rows; // pivot_rows[j] is the index of the row with its leading entry in column j, or -1
+};
+
+// Divide the entries of "row" in columns start, start+1, ... by their gcd (the other entries must be zero)
+void RowEchelonForm::RemoveContent(vec_ZZ &row, long start)
+{
+	ZZ content;
+	for (long j=start; j<row.length() && !IsOne(content); j++) {
+		if (!IsZero(row[j]))
+			content = GCD(content, row[j]);
+	}
+	if (IsZero(content) || IsOne(content))
+		return;
+	for (long j=start; j<row.length(); j++) {
+		if (!IsZero(row[j]))
+			div(row[j], row[j], content);
 	}
+}
 
-	cerr << D1 << endl;
+bool RowEchelonForm::AddRow(vec_ZZ row)
+{
+	ZZ g, a, b;
+	for (long j=0; j<row.length(); j++) {
+		if (IsZero(row[j]))
+			continue;
+		long pivot = pivot_rows[j];
+		if (pivot < 0) {
+			// The leading entry of the reduced row is in a new column, so the row is linearly independent
+			RemoveContent(row, j);
+			pivot_rows[j] = (long)rows.size();
+			rows.push_back(row);
+			return true;
+		}
+		// row = a * row - b * rows[pivot] cancels the entry in column j. The entries before column j are zero in both rows.
+		const vec_ZZ &pivot_row = rows[pivot];
+		g = GCD(row[j], pivot_row[j]);
+		div(a, pivot_row[j], g);
+		div(b, row[j], g);
+		for (long k=j; k<row.length(); k++) {
+			row[k] = a * row[k] - b * pivot_row[k];
+		}
+		RemoveContent(row, j+1);
+	}
+	return false;
+}
 
-	rank = image(d, D1);
+void FindHomologyBasis(const ReducedDifferential &d1, const ReducedDifferential &d2, OrderedLCBasis &homologyBasis, OrderedLCBasis &imageBasis, const OrderedBasis &source)
+{
+	PROFILE_SCOPE(PHASE_QUOTIENT);
+	// A basis of cocycles comes with the reduction of d_n
+	const OrderedLCBasis &cocyclesBasis = d2.kernel;
+	int source_size = (int)source.size();
 
 	// The dimension of ker(d_n) / im(d_{n-1}) is supposed to be dim_ker - dim_img.
 	int dim_ker = (int)cocyclesBasis.size();
-	int dim_img = rank;
+	int dim_img = (int)d1.image.size();
+	PROFILE_COUNT(PHASE_QUOTIENT, dim_ker);
 
-	// Loop through the last dim_img rows of U and store the result into imageBasis
+	// Store the basis of the image of d_{n-1} into imageBasis
 	imageBasis.clear();
-	for (int i=d1_cols_size-dim_img; i<d1_cols_size; i++) {
+	vector<CoefficientVector>::const_iterator iter;
+	for (iter = d1.image.begin(); iter != d1.image.end(); iter++) {
 		LinearCombination lc;
-		for (int j=0; j<d1_rows_size; j++) {
-			assert(NumBits(D1[i][j]) < 32);
-			int coeff = to_int(D1[i][j]);
-			if (coeff != 0) {
-				lc.AddTerm(coeff, source[j]);
-			}
+		CoefficientVector::const_iterator entry;
+		for (entry = iter->begin(); entry != iter->end(); entry++) {
+			lc.AddTerm(entry->second, source[(size_t)entry->first]);
 		}
 		imageBasis.push_back(lc);
 	}
 
+	// If the differential d1 is zero, we are done here, we can return homologyBasis = cocyclesBasis
+	if (dim_img == 0) {
+		homologyBasis = cocyclesBasis;
+		return;
+	}
+
 	homologyBasis.clear();
+	if (dim_img >= dim_ker) {
+		return;
+	}
+	IndexedBasis indexed_source(source);
 	// Here, we need to extend the basis of the image of im(d_{n-1}) to a basis of ker(d_n)
 	// We will do this by appending as many elements of cocycleBasis as possible, making sure our set of vectors
-	// is linearly independant at every step.
-	// Note: This is very unefficient and I wish I could do it in one step, by reducing a single matrix to it's HNF, but
-	// I can't figure out how to do this with NTL. In any case I think NTL is fast enough so that it shouldn't be the bottleneck here.
-
-	// TMP:
-
-	mat_ZZ extended_basis;
-	extended_basis.SetDims(dim_ker - dim_img, d1_rows_size); // Each column vector of this matrix will be a basis vector in the extended basis
-	int extended_basis_vectors_found = 0;
-	int cocycle_index = 0;
-	if (dim_img < dim_ker) {
-		do {
-			mat_ZZ D;
-			D.SetDims(dim_img+extended_basis_vectors_found+1, d1_rows_size);
-			for (int i=0; i<dim_img; i++) {
-				D[i] = D1[d1_cols_size-dim_img+i];
-			}
-			for (int i=dim_img; i<dim_img+extended_basis_vectors_found; i++) {
-				D[i] = extended_basis[i-dim_img];
-			}
-			// Check for linear independence with the following new vector added
-			GetCoordinates(cocyclesBasis[cocycle_index], D[dim_img+extended_basis_vectors_found], source);
-			int rank = LLL(d, D);
-			if (rank > dim_img+extended_basis_vectors_found) {
-				// The rank has increased, so the extended set of vectors is still linearly independant
-				GetCoordinates(cocyclesBasis[cocycle_index], extended_basis[extended_basis_vectors_found], source);
-				homologyBasis.push_back(cocyclesBasis[cocycle_index]);
-				++extended_basis_vectors_found;
-			}
-			cocycle_index++;
-		} while (dim_img+extended_basis_vectors_found < dim_ker && cocycle_index < dim_ker);
+	// is linearly independant at every step. All of this is done in a single row echelon form: the rows of the image
+	// are added first, then the cocycles one by one, and a cocycle is kept exactly when it does not reduce to zero.
+	RowEchelonForm echelon(source_size);
+	for (iter = d1.image.begin(); iter != d1.image.end(); iter++) {
+		vec_ZZ row;
+		row.SetLength(source_size);
+		CoefficientVector::const_iterator entry;
+		for (entry = iter->begin(); entry != iter->end(); entry++) {
+			entry->second.GetZZ(row[(long)entry->first]);
+		}
+		echelon.AddRow(row);
+	}
+	vec_ZZ cocycle;
+	cocycle.SetLength(source_size);
+	for (int cocycle_index=0; cocycle_index<dim_ker && dim_img+(int)homologyBasis.size()<dim_ker; cocycle_index++) {
+		GetCoordinates(cocyclesBasis[cocycle_index], cocycle, indexed_source);
+		if (echelon.AddRow(cocycle)) {
+			// The rank has increased, so the extended set of vectors is still linearly independant
+			homologyBasis.push_back(cocyclesBasis[cocycle_index]);
+		}
+	}
+
+	if (dim_img+(int)homologyBasis.size() < dim_ker)
+		throw logic_error("Fatal error. Failed to compute a quotient space basis.");
+}
+
+HomologyWindow::HomologyWindow(FreeCGA &_cdga, Differential &_diff, int _minLength, const ExtraGrading &_grading, int _threads)
+	: cdga(_cdga), diff(_diff), minLength(_minLength), grading(_grading), threads(_threads)
+{
+	degree = 0;
+}
 
-		if (dim_img+extended_basis_vectors_found < dim_ker)
-			throw logic_error("Fatal error. Failed to compute a quotient space basis.");
+void HomologyWindow::Start(int first_degree)
+{
+	// Nothing is known of the first degree yet, so the window starts one degree before it
+	degree = first_degree-1;
+	cdga.GetBasisInDegreeExtended(source, degree, minLength);
+	cdga.GetBasisInDegreeExtended(target, degree+1, minLength);
+	reduced.Clear();
+	if (!source.empty() && !target.empty()) {
+		SparseMatrix diff_matrix_prev;
+		diff.ComputeDifferentialMatrix(diff_matrix_prev, source, target);
+		ReduceDifferential(diff_matrix_prev, reduced, source, target, grading, threads);
+	}
+}
+
+void HomologyWindow::Resume(int _degree, ReducedDifferential &_reduced)
+{
+	degree = _degree;
+	cdga.GetBasisInDegreeExtended(target, degree+1, minLength);
+	reduced.Swap(_reduced);
+}
+
+void HomologyWindow::Move(int _degree)
+{
+	assert(_degree == degree+1);
+	degree = _degree;
+	reduced_prev.Swap(reduced);
+	reduced.Clear();
+	source.swap(target);
+	cdga.GetBasisInDegreeExtended(target, degree+1, minLength);
+	indexed_target.SetBasis(target);
+
+	diff_matrix.SetDims(0, (long long)source.size());
+	if (!source.empty() && !target.empty()) {
+		// This compute the differential of d : (deg n) ---> (deg n+1) and store it into "diff_matrix"
+		diff.ComputeDifferentialMatrix(diff_matrix, source, indexed_target);
+	}
+}
+
+void HomologyWindow::Reduce(OrderedLCBasis &homologyBasis, OrderedLCBasis &imageBasis)
+{
+	homologyBasis.clear();
+	imageBasis.clear();
+	if (source.empty()) {
+		return;
 	}
-}
\ No newline at end of file
+	// The kernel of d_n gives the cocycles, and the image of d_n is kept for the next degree
+	ReduceDifferential(diff_matrix, reduced, source, target, grading, threads);
+	// Finally, find a basis for the homology in degree n. If the image of d_{n-1} is zero, none of the cocycles will be
+	// boundaries.
+	FindHomologyBasis(reduced_prev, reduced, homologyBasis, imageBasis, source);
+}
+
+void HomologyWindow::ExtendTarget(int first_generator)
+{
+	cdga.ExtendBasisInDegree(target, degree+1, first_generator);
+}
+
+void HomologyWindow::Clear()
+{
+	OrderedBasis().swap(source);
+	OrderedBasis().swap(target);
+	indexed_target = IndexedBasis();
+	diff_matrix.Clear();
+	reduced_prev.Clear();
+	reduced.Clear();
+}
+
+void ComputeHomologyDimensions(const FreeCGA &cdga, Differential &diff, const BasisRanker &ranker, int degree_start, int degree_end, int minLength, vector<long long> &dimensions)
+{
+	dimensions.assign(max(degree_end - degree_start + 1, 0), 0);
+	SparseMatrix diff_matrix;
+
+	// The rank of d_{n-1} is carried over from the previous degree
+	long long rank_prev = 0;
+	for (int degree = degree_start-1; degree <= degree_end; degree++) {
+		long long rank = 0;
+		PROFILE_DEGREE(degree);
+		if (ranker.GetDimension(degree) != 0 && ranker.GetDimension(degree+1) != 0) {
+			BasisIterator source(cdga, degree, minLength, true);
+			diff.ComputeDifferentialMatrix(diff_matrix, source, ranker);
+			rank = ComputeRank(diff_matrix);
+			diff_matrix.Clear();
+		}
+
+		if (degree >= degree_start) {
+			// dim H^n = dim ker(d_n) - dim im(d_{n-1})
+			dimensions[degree - degree_start] = ranker.GetDimension(degree) - rank - rank_prev;
+		}
+		rank_prev = rank;
+	}
+}
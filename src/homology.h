@@ -2,18 +2,95 @@
 #define _HOMOLOGY__H
 
 #include "cdga.h"
+#include "grading.h"
+
+// The result of the lattice reduction of a differential d_n : X^n ---> X^{n+1}.
+// "kernel" is a basis of ker(d_n) and "image" is a basis of im(d_n), given by its coordinates in the basis of X^{n+1}.
+// The image is what the next degree needs, so a range of degrees only has to reduce each differential once.
+class ReducedDifferential
+{
+public:
+	OrderedLCBasis kernel;
+	vector<CoefficientVector> image;
+
+	void Clear();
+	void Swap(ReducedDifferential &other);
+};
+
+// The parameter "differential_matrix" must be the matrix of a differential d_n : X^{n} ---> X^{n+1},
+// with respect to the ordered basis "source". The method will return a basis of ker(d_n) and a basis of im(d_n).
+// A matrix without rows or without columns stands for the zero differential.
+void ReduceDifferential(const SparseMatrix &differential_matrix, ReducedDifferential &result, const OrderedBasis &source);
+
+// Same as above, but the matrix is first split into the blocks of an extra grading (see grading.h): the columns of the
+// words of X^n of given weights only have entries in the rows of the words of X^{n+1} whose weights are shifted by the
+// differential. The blocks are reduced independently on "threads" threads (0 means one per processor), and the kernel
+// and the image are made of the results of the blocks in the order of their weights, so they don't depend on the
+// number of threads. The parameter "target" must be the basis of X^{n+1} of the rows of the matrix.
+void ReduceDifferential(const SparseMatrix &differential_matrix, ReducedDifferential &result, const OrderedBasis &source, const OrderedBasis &target, const ExtraGrading &grading, int threads);
 
 // The parameter "differential_matrix" must be the matrix of a differential d_n : X^{n} ---> X^{n+1},
 // with respect to the ordered basis "source". The method will return a basis of ker(d_n).
-// The parameter "source" must be an ordered matrix in dimension n (hence it must have cols_size vectors)
-void FindCocycleBasis(int **differential_matrix, int rows_size, int cols_size, OrderedLCBasis &cocycleBasis, const OrderedBasis &source);
+// The parameter "source" must be an ordered matrix in dimension n (hence it must have one vector per column)
+// A matrix without rows or without columns stands for the zero differential.
+void FindCocycleBasis(const SparseMatrix &differential_matrix, OrderedLCBasis &cocycleBasis, const OrderedBasis &source);
 
-// The parameter "d1" must be the matrix of the differential d_{n-1} : X^{n-1} ---> X^n.
-// The parameter "d2" must be the matrix of the differential d_n : X^n ---> X^{n+1}.
-// The parameter "source" must be an ordered basis in degree n (hence must have d2_cols_size vectors)
+// The parameter "d1" must be the reduction of the differential d_{n-1} : X^{n-1} ---> X^n.
+// The parameter "d2" must be the reduction of the differential d_n : X^n ---> X^{n+1}.
+// The parameter "source" must be an ordered basis in degree n (hence must have one vector per column of d_n)
 // The method will find a basis of cocycles which are not boundaries in X^n.
 // The method also returns a basis for im(d_{n-1}) as the parameter "imageBasis"
 
-void FindHomologyBasis(int **d1, int d1_rows_size, int d1_cols_size, int **d2, int d2_rows_size, int d2_cols_size, OrderedLCBasis &homologyBasis, OrderedLCBasis &imageBasis, const OrderedBasis &source);
+void FindHomologyBasis(const ReducedDifferential &d1, const ReducedDifferential &d2, OrderedLCBasis &homologyBasis, OrderedLCBasis &imageBasis, const OrderedBasis &source);
+
+// The rolling window with which a basis of the homology is found over a range of degrees (see ComputeModel in
+// main.cpp). In degree n, only the bases of X^n and X^{n+1}, the matrix of d_n and the reductions of d_{n-1} and d_n
+// are held, and the reduction of d_n is carried over to degree n+1, so every differential is assembled and reduced only
+// once. The matrices are split into the blocks of "grading", which may be detected again between two degrees.
+class HomologyWindow
+{
+public:
+	HomologyWindow(FreeCGA &_cdga, Differential &_diff, int _minLength, const ExtraGrading &_grading, int _threads);
+
+	// Reduce d_{n-1} for the first degree n of a range
+	void Start(int first_degree);
+	// Carry on from degree n, whose reduction of d_n was found by an earlier run (see checkpoint.h). The reduction is
+	// taken from "reduced".
+	void Resume(int degree, ReducedDifferential &reduced);
+	// Move the window to the degree after the last one: X^n is the target of the previous degree, X^{n+1} is the only
+	// new basis, and the matrix of d_n is assembled
+	void Move(int degree);
+	// Reduce d_n and find a basis of the homology in degree n, and a basis of the image of d_{n-1}
+	void Reduce(OrderedLCBasis &homologyBasis, OrderedLCBasis &imageBasis);
+	// Append to the basis of X^{n+1} the words which contain the generators of T from "first_generator" on, which
+	// were added after the basis was found. The words which were already there keep their coordinates.
+	void ExtendTarget(int first_generator);
+	// Free the memory of the bases, the matrix and the reductions
+	void Clear();
+
+	// The bases of X^n and X^{n+1}, the matrix of d_n and its reduction, in the last degree the window was moved to
+	const OrderedBasis &GetSource() const { return source; }
+	const SparseMatrix &GetMatrix() const { return diff_matrix; }
+	const ReducedDifferential &GetReduction() const { return reduced; }
+
+private:
+	FreeCGA &cdga;
+	Differential &diff;
+	int minLength;
+	const ExtraGrading &grading;
+	int threads;
+
+	int degree;
+	OrderedBasis source, target;
+	IndexedBasis indexed_target;
+	SparseMatrix diff_matrix; // A matrix without rows stands for the zero differential
+	ReducedDifferential reduced_prev, reduced;
+};
+
+// Compute the dimension of the homology of /\^{>=minLength}X (+) (/\^{+}X (x) T in each degree n of the range, from the
+// ranks of d_{n-1} and d_n computed modulo random primes (see modular.h), and store them in "dimensions". The bases are
+// never materialized: the source basis of each differential is read in chunks from a BasisIterator and the target basis
+// is described by "ranker", which must go up to degree_end+1.
+void ComputeHomologyDimensions(const FreeCGA &cdga, Differential &diff, const BasisRanker &ranker, int degree_start, int degree_end, int minLength, vector<long long> &dimensions);
 
 #endif 
\ No newline at end of file
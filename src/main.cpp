@@ -4,10 +4,27 @@
 #include <sstream>
 #include <fstream>
 #include <iomanip>
-#include <Windows.h>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
 
 #include "cdga.h"
 #include "homology.h"
+#include "modular.h"
+#include "ranking.h"
+#include "enumeration.h"
+#include "planner.h"
+#include "profile.h"
+#include "checkpoint.h"
+#include "matrixio.h"
+#include "fileio.h"
+#include "grading.h"
+#include "spectral.h"
 
 using namespace std;
 
@@ -29,6 +46,33 @@ using namespace std;
 // (6) The "category" of the space. This parameter is optional. If this is provided, then rather than computing a
 // minimal model for /\X, the program will calculate a minimal model for the projection of /\X ---> /\X / /\^{>n} X,
 // where 'n' is the category.
+// (7) What to compute. This parameter is optional. Writing "compute = betti" only outputs the dimension of the homology
+// in each degree, which is much faster than computing a basis of cocycles ("compute = extension", the default).
+// Writing "compute = pipeline" automates the computation of the rational retraction index described below: the
+// homology of each degree of the range is killed by new generators of T, and the next degree is computed with them,
+// so that the extension file no longer has to be copied into the input by hand. The extension file then holds all
+// the generators added over the range.
+// (8) The number of threads used to compute the matrices of the differential. This parameter is optional, for example
+// "threads = 8". The default is 1, and "threads = 0" uses one thread per processor.
+// (9) A memory budget in megabytes. This parameter is optional, for example "memory = 4096". A run whose estimated
+// memory exceeds the budget is refused before it starts. Writing "compute = plan" only outputs the dimensions of the
+// bases and the estimated cost of the two other computations, without computing anything else.
+// Writing "compute = matrices" only writes the matrices of the differentials d_{n-1}, ..., d_m for the range n..m to
+// files named after the input file, which can then be handed to other programs (see ExportMatrices below). The line
+// "matrix-format = market" writes them in the Matrix Market format instead of the default "matrix-format = binary".
+// Writing "compute = spectral" outputs the dimensions of the pages of the spectral sequence of the filtration by word
+// length in each degree (see spectral.h), which converges to the dimension of the homology. It needs about as much memory
+// as "compute = betti", and outputs no basis.
+// (10) A checkpoint file. This parameter is optional, for example "checkpoint = model.ckpt". With "compute = extension"
+// or "compute = pipeline", the results of each degree (the bases, the matrices, the cocycles and the homology) are
+// appended to this binary file as soon as they are computed. A run which finds a checkpoint of the same model reads the
+// degrees it holds instead of computing them again, so a run which was interrupted carries on at the first degree which
+// is missing, and a run over a longer range only computes the new degrees.
+// (11) Whether to look for an extra grading. This parameter is optional. By default ("grading = auto"), the program looks
+// for gradings of the generators which the differential respects besides the degree (see grading.h), and if there are
+// any, the matrix of each differential is split into blocks which are reduced independently, on the threads of option
+// (8). Writing "grading = none" always reduces the whole matrix. The bases of the homology may differ between the two,
+// but they span the same space.
 //
 // NOTATION: Denote by Z the (/\X, d)-differential graded module Z = (/\X (+) (/\X (x) T)).
 //
@@ -44,6 +88,14 @@ using namespace std;
 // at the cost of performance)
 // (2) You cannot give the label "1" to a generator, because this labels stands for the unit in /\X. Also the label "0" is reserved.
 // Moreover, the following characters cannot be used in a label: ' ', '+', '-', '(', ')', '*', '^'.
+//
+// BATCH MODE: "cdga-generators -batch [-workers n] [-manifest file] [file ...]" runs many input files in one process,
+// without asking anything and without pausing at exit. The files are the arguments, followed by those listed in the
+// manifest (one per line, '#' starts a comment). They are computed concurrently by n workers (default: one per
+// processor). The output of each file goes to the file named in its input, or to the input file followed by ".out",
+// and is written at once when the file is done. A table with the outcome and the time of every file is printed at the
+// end, and the exit code is 1 if any file failed. The threads of the differentials (option (8)) come on top of the workers.
+// The messages of a file (on the standard error) start with its name, since the files are computed at the same time.
 
 // TODO: Make the program check automatically if d^2 = 0 and if the differential has degree +1?
 // TODO: Automate the entire process of computing the rational retraction index. This can be done, although the work required is almost
@@ -55,6 +107,8 @@ using namespace std;
 //       computed recursively until the rational index is found. Instead, at the moment, the files must be manually edited between each
 //       step or a range of degrees must be used at the same time, which can be very computationally expensive due to exponential growth
 //       of work required for the linear algebra step as the degree increases. 
+//       Note: "compute = pipeline" now runs these steps in a single process, carrying the bases, the reductions and the cache
+//       of the differential from one degree to the next, but its output is not yet a valid input file.
 //       For example, we need to switch to symbols that support an arbitrary amount of alphabet letters (rather than 1), otherwise we shall
 //       get stuck once Z requires more than 26 generator in a certain degree, among other things.
 //  (2)  For each step above (i.e. everytime we increase the degree of T and introduce a new set of generators for that degree, starting
@@ -68,119 +122,359 @@ static streambuf* buffer;
 
 static void pause()
 {
+#ifdef _WIN32
+	// Keep the console open when the program was started from the explorer
 	cout << endl;
 	system("pause");
+#endif
 }
 
-void RunTest1(const string &input_filename, ofstream &output)
+// Output only the dimension of the homology in each degree of the range. The ranks of the differentials are computed
+// modulo random primes (see modular.h) and the bases are never materialized: the source basis of each differential
+// is read in chunks from a BasisIterator and the target basis is described by a BasisRanker.
+static void ComputeBettiNumbers(const FreeCGA &cdga, Differential &diff, int degree_start, int degree_end, int category, ostream &out)
 {
-	FreeCGA cdga;
-	Differential diff;
-	int degree_start, degree_end;
-	int category;
-	string output_filename, extension_output_filename;
+	BasisRanker ranker(cdga, degree_end+1, category+1, true);
+	vector<long long> dimensions;
+	ComputeHomologyDimensions(cdga, diff, ranker, degree_start, degree_end, category+1, dimensions);
+	for (int degree = degree_start; degree <= degree_end; degree++) {
+		out << "HOMOLOGY DEGREE " << degree << " (DIM " << dimensions[degree - degree_start] << "):" << endl << endl;
+	}
+
+	out << "Here are the dimensions of the extended cdga from degree 0 up to degree " << degree_end+1 << "." << endl << endl;
+	for (int deg=0; deg<=degree_end+1; deg++) {
+		out << "DEGREE " << deg << " (dim " << ranker.GetDimension(deg) << ")" << endl;
+	}
+	out << endl;
+}
+
+// Output the dimensions of the pages of the spectral sequence of the word length filtration (see spectral.h) in each
+// degree of the range, one line per page with one dimension per word length, up to the page E_inf whose total dimension
+// is the dimension of the homology. Like ComputeBettiNumbers, the dimensions are computed modulo random primes.
+static void ComputeSpectralSequence(const FreeCGA &cdga, Differential &diff, int degree_start, int degree_end, int category, ostream &out)
+{
+	LengthSpectralSequence sequence;
+	sequence.Compute(cdga, diff, degree_start, degree_end, category);
+
+	for (int degree = degree_start; degree <= degree_end; degree++) {
+		out << "HOMOLOGY DEGREE " << degree << " (DIM " << sequence.GetHomologyDimension(degree) << "):" << endl << endl;
+		int min_length = sequence.GetMinLength(degree);
+		int max_length = sequence.GetMaxLength(degree);
+		if (max_length < min_length) {
+			continue;
+		}
+		out << "Dimensions of the pages by word length, from " << min_length << " to " << max_length << ":" << endl;
+		for (int page=0; page<=sequence.GetLastPage(degree); page++) {
+			out << "E_" << page;
+			if (page == sequence.GetLastPage(degree)) {
+				out << " = E_inf";
+			}
+			out << ":";
+			for (int length=min_length; length<=max_length; length++) {
+				out << " " << sequence.GetDimension(degree, page, length);
+			}
+			out << endl;
+		}
+		out << endl;
+	}
+}
+
+// Write the matrices of the differentials d_{n-1}, ..., d_m for the range of degrees n..m to the files "<input>.d<k>.csc"
+// (or "<input>.d<k>.mtx" in the Matrix Market format), so that they can be handed to other programs. Like
+// ComputeBettiNumbers, the bases are never materialized, and the columns of each matrix are written to its file as they
+// are computed, so a matrix never has to fit in memory.
+static void ExportMatrices(const FreeCGA &cdga, Differential &diff, const string &input_filename, const OutputOptions &options, ostream &out)
+{
+	int degree_start = options.homology_degree_start;
+	int degree_end = options.homology_degree_end;
+	int category = options.category;
+	BasisRanker ranker(cdga, degree_end+1, category+1, true);
+
+	for (int degree = degree_start-1; degree <= degree_end; degree++) {
+		PROFILE_DEGREE(degree);
+		stringstream filename;
+		filename << input_filename << ".d" << degree << (options.matrix_format == MATRIX_MARKET ? ".mtx" : ".csc");
+		MatrixWriter writer;
+		if (!writer.Open(filename.str(), options.matrix_format, ranker.GetDimension(degree+1))) {
+			throw logic_error("Unable to write file '" + filename.str() + "'.");
+		}
+		if (ranker.GetDimension(degree) != 0 && ranker.GetDimension(degree+1) != 0) {
+			BasisIterator source(cdga, degree, category+1, true);
+			diff.ComputeDifferentialMatrix([&writer](const SparseMatrix &columns) { writer.AppendColumns(columns); }, source, ranker);
+		} else {
+			// The zero map, from or to the zero space
+			SparseVector zero;
+			for (long long j=0; j<ranker.GetDimension(degree); j++) {
+				writer.AppendColumn(zero);
+			}
+		}
+		if (!writer.Close()) {
+			throw logic_error("Unable to write file '" + filename.str() + "'.");
+		}
+		if (options.matrix_format == MATRIX_BINARY) {
+			// Map the file back, which checks it without copying it into memory, to make sure that it holds the matrix
+			// which was written (a Matrix Market file would have to be parsed in full)
+			MappedMatrix written;
+			if (!written.Open(filename.str()) || written.GetRows() != writer.GetRows() || written.GetCols() != writer.GetCols() ||
+				written.GetNonZeros() != writer.GetNonZeros()) {
+				throw logic_error("The file '" + filename.str() + "' doesn't hold the matrix which was written.");
+			}
+		}
+		out << "MATRIX OF d_" << degree << ": " << writer.GetRows() << " x " << writer.GetCols() << ", " << writer.GetNonZeros()
+			<< " non-zero entries, written to '" << filename.str() << "'" << endl;
+	}
+	out << endl;
+
+	out << "Here are the dimensions of the extended cdga from degree 0 up to degree " << degree_end+1 << "." << endl << endl;
+	for (int deg=0; deg<=degree_end+1; deg++) {
+		out << "DEGREE " << deg << " (dim " << ranker.GetDimension(deg) << ")" << endl;
+	}
+	out << endl;
+}
+
+// Output the estimated resources of each degree of a plan (see planner.h)
+static void OutputPlan(const vector<DegreePlan> &plan, ostream &out)
+{
+	vector<DegreePlan>::const_iterator iter;
+	for (iter = plan.begin(); iter != plan.end(); iter++) {
+		out << "DEGREE " << iter->degree << ": " << iter->dim_target << " x " << iter->dim_source << " matrix, at most "
+			<< iter->nonzeros << " non-zero entries, " << fixed << setprecision(1) << iter->memory / (1024 * 1024) << " MB, "
+			<< scientific << setprecision(2) << iter->operations << " operations" << endl;
+		out.unsetf(ios::floatfield);
+	}
+	out << "Estimated peak memory: " << fixed << setprecision(1) << GetPeakMemory(plan) / (1024 * 1024) << " MB" << endl << endl;
+	out.unsetf(ios::floatfield);
+	out << setprecision(6);
+}
+
+// Output the dimensions of the bases, computed from the Poincare series of the extended cdga, and the estimated cost of
+// both computations in every degree of the range
+static void ComputePlan(const FreeCGA &cdga, const Differential &diff, const OutputOptions &options, int degree_end, ostream &out)
+{
+	PoincareSeries series(cdga, diff, degree_end+1, options.category+1, true);
+	out << "Here are the dimensions of the extended cdga from degree 0 up to degree " << degree_end+1 << "." << endl << endl;
+	for (int deg=0; deg<=degree_end+1; deg++) {
+		out << "DEGREE " << deg << " (dim " << series.GetDimension(deg) << ")" << endl;
+	}
+	out << endl;
+
+	// Each line describes the matrix of d_n : Z^n --> Z^{n+1}
+	vector<DegreePlan> plan;
+	PlanRun(plan, cdga, diff, options, COMPUTE_EXTENSION);
+	out << "Here is the estimated cost of computing a basis of cocycles (compute = extension)." << endl << endl;
+	OutputPlan(plan, out);
+	PlanRun(plan, cdga, diff, options, COMPUTE_BETTI);
+	out << "Here is the estimated cost of computing only the dimension of the homology (compute = betti)." << endl << endl;
+	OutputPlan(plan, out);
+}
 
-	if (!ReadInputFromFile(input_filename, output_filename, extension_output_filename, cdga, diff, degree_start, degree_end, category)) {
+// Read an input file and check the degrees it asks for. The end of the range is set to its start if there is no range.
+// Returns false, after outputting the reason to cerr, if the input is invalid.
+static bool ReadModel(const string &input_filename, FreeCGA &cdga, Differential &diff, OutputOptions &options)
+{
+	if (!ReadInputFromFile(input_filename, cdga, diff, options)) {
 		cerr << "Failure to read input file '" << input_filename << "'." << endl;
-		return;
+		return false;
 	}
+	diff.SetThreadCount(options.threads);
 
-	if (degree_start <= 1) {
+	if (options.homology_degree_start <= 1) {
 		cerr << "Invaid degree. The degree must be greater or equal to 2." << endl;
-		return;
+		return false;
 	}
-	if (degree_end < degree_start) {
-		degree_end = degree_start;
+	if (options.homology_degree_end < options.homology_degree_start) {
+		options.homology_degree_end = options.homology_degree_start;
 	}
+	return true;
+}
 
-	if (!output_filename.empty()) {
-		output.open(output_filename);
-		cout << "Redirecting all output to '" << output_filename << "'..." << endl;
-		// Make cout redirect to "output"
-		buffer = cout.rdbuf();
-		cout.rdbuf(output.rdbuf());
+// Kill the homology in degree n of a model: each cocycle of the basis becomes the differential of a new generator of T
+// in degree n-1, labelled "l<n-1>_<index>". The new generators and their differentials are also written to "extension"
+// and "differential", in the format of the sections of an input file.
+// The words of T always have a factor in X, whose generators have degree 2 or more, so the new generators only change
+// the extended basis from degree n+1 on, where their words are appended (see FreeCGA::ExtendBasisInDegree). Everything
+// computed so far stays valid, and so does the cache of the differential (see Differential::Invalidate).
+static void KillHomology(FreeCGA &cdga, Differential &diff, const OrderedLCBasis &cocycles, int degree, ostream &extension, ostream &differential)
+{
+	int num_digits = (int)ceil(log((double)cocycles.size()+1.0)/log(10.0));
+	for (size_t i=0; i<cocycles.size(); i++) {
+		stringstream ss;
+		ss << "l" << degree-1 << "_" << setfill('0') << setw(num_digits) << i+1;
+		string label = ss.str();
+		// This throws if the label is already taken
+		cdga.AddExtensionGenerator(label, degree-1);
+		diff.SetDifferential(label, cocycles[i]);
+		extension << label << " " << degree-1 << endl;
+		differential << "d(" << label << ") = " << cocycles[i].OutputString() << endl;
+	}
+}
+
+// Return true if the first record of a checkpoint, of degree n, was written for the bases of X^n and X^{n+1} this run
+// has. The fingerprint of the model doesn't cover the order in which the words are enumerated, and the coordinates of
+// every record depend on it.
+static bool MatchesCheckpoint(const CheckpointReader &reader, const FreeCGA &cdga, int degree, int minLength)
+{
+	OrderedBasis basis, checkpoint_basis, target;
+	cdga.GetBasisInDegreeExtended(basis, degree, minLength);
+	reader.ReadBasis(0, checkpoint_basis, cdga.GetGeneratorRegistry());
+	if (checkpoint_basis != basis) {
+		return false;
+	}
+	SparseMatrix matrix;
+	reader.ReadMatrix(0, matrix);
+	cdga.GetBasisInDegreeExtended(target, degree+1, minLength);
+	return matrix.GetCols() == (long long)basis.size() && matrix.GetRows() == (long long)target.size();
+}
+
+// Compute what the options of a model ask for and write the results to "out". The file of the extension, if there is
+// one, is written as well. Returns false if the run was refused because it exceeds the memory budget.
+// With "compute = pipeline", the model is extended by the generators killing the homology of each degree.
+static bool ComputeModel(const string &input_filename, FreeCGA &cdga, Differential &diff, const OutputOptions &options, ostream &out)
+{
+	int degree_start = options.homology_degree_start;
+	int degree_end = options.homology_degree_end;
+	int category = options.category;
+	const string &extension_output_filename = options.extension_output_filename;
+
+	out << "Successfully parsed input file '" << input_filename << "'..." << endl;
+	if (options.compute == COMPUTE_PLAN) {
+		if (degree_start < degree_end) {
+			out << "Now estimating the cost of computing the homology in degrees " << degree_start << " to " << degree_end << " (assuming the category to be " << category << ")..." << endl << endl;
+		} else {
+			out << "Now estimating the cost of computing the homology in degree " << degree_start << " (assuming the category to be " << category << ")..." << endl << endl;
+		}
+		ComputePlan(cdga, diff, options, degree_end, out);
+		return true;
+	}
+	if (options.memory_budget > 0) {
+		vector<DegreePlan> plan;
+		PlanRun(plan, cdga, diff, options, options.compute);
+		if (GetPeakMemory(plan) > options.memory_budget * 1024 * 1024) {
+			cerr << "The estimated memory of the run exceeds the budget of " << options.memory_budget << " MB." << endl;
+			out << "The run was refused, because its estimated memory exceeds the budget of " << options.memory_budget << " MB." << endl << endl;
+			OutputPlan(plan, out);
+			return false;
+		}
+	}
+	if (options.compute == COMPUTE_BETTI) {
+		if (degree_start < degree_end) {
+			out << "Now computing the dimension of the homology in degrees " << degree_start << " to " << degree_end << " (assuming the category to be " << category << ")..." << endl << endl;
+		} else {
+			out << "Now computing the dimension of the homology in degree " << degree_start << " (assuming the category to be " << category << ")..." << endl << endl;
+		}
+		ComputeBettiNumbers(cdga, diff, degree_start, degree_end, category, out);
+		return true;
+	}
+	if (options.compute == COMPUTE_SPECTRAL) {
+		if (degree_start < degree_end) {
+			out << "Now computing the spectral sequence of the word length filtration in degrees " << degree_start << " to " << degree_end << " (assuming the category to be " << category << ")..." << endl << endl;
+		} else {
+			out << "Now computing the spectral sequence of the word length filtration in degree " << degree_start << " (assuming the category to be " << category << ")..." << endl << endl;
+		}
+		ComputeSpectralSequence(cdga, diff, degree_start, degree_end, category, out);
+		return true;
+	}
+	if (options.compute == COMPUTE_MATRICES) {
+		out << "Now writing the matrices of the differentials from degree " << degree_start-1 << " to " << degree_end << " (assuming the category to be " << category << ")..." << endl << endl;
+		ExportMatrices(cdga, diff, input_filename, options, out);
+		return true;
 	}
 
-	cout << "Successfully parsed input file '" << input_filename << "'..." << endl;
-	if (degree_start < degree_end) {
-		cout << "Now computing a basis of cocycles for the homology in degrees " << degree_start << " to " << degree_end << " (assuming the category to be " << category << ")..." << endl << endl;
+	bool pipeline = (options.compute == COMPUTE_PIPELINE);
+	if (pipeline) {
+		vector<vector<Generator> > X_basis = cdga.GetGradedVectorSpace().GetDegreeIndexedBasis();
+		if ((X_basis.size() > 0 && !X_basis[0].empty()) || (X_basis.size() > 1 && !X_basis[1].empty())) {
+			throw logic_error("The pipeline requires the generators of X to have degree 2 or more.");
+		}
+		out << "Now killing the homology degree by degree, from degree " << degree_start << " to " << degree_end << " (assuming the category to be " << category << ")..." << endl << endl;
+	} else if (degree_start < degree_end) {
+		out << "Now computing a basis of cocycles for the homology in degrees " << degree_start << " to " << degree_end << " (assuming the category to be " << category << ")..." << endl << endl;
 	} else {
-		cout << "Now computing a basis of cocycles for the homology in degree " << degree_start << " (assuming the category to be " << category << ")..." << endl << endl;
+		out << "Now computing a basis of cocycles for the homology in degree " << degree_start << " (assuming the category to be " << category << ")..." << endl << endl;
 	}
 	
-	vector<OrderedBasis> basis;
-	cdga.GetDegreeIndexedBasisExtended(basis, degree_end, category+1);
-	
-	for (int degree = degree_start; degree <= degree_end; degree++) {
-		// Here we compute a cocycles basis in the specified degree
-		int dim_source = (int)basis[degree].size();
-		int dim_target = (int)basis[degree+1].size();
-		OrderedLCBasis cocycles_basis, image_basis;
-		if (dim_source != 0) {
-			// Allocate memory for the matrix
-			int **diff_matrix = 0;
-		
-			if (dim_target != 0) {
-				diff_matrix = new int*[dim_target];
-				for (int i=0; i<dim_target; i++) {
-					diff_matrix[i] = new int[dim_source];
-				} 
-
-				// This compute the differential of d : (deg n) ---> (deg n+1) and store it into "diff_matrix"
-				diff.ComputeDifferentialMatrix(diff_matrix, basis[degree], basis[degree+1]);
+	// The generators added by the pipeline, in the format of an input file
+	ostringstream pipeline_extension, pipeline_differential;
+
+	// With a checkpoint, the degrees done by an earlier run of the same model are read back from it instead of being
+	// computed again, and every degree which is computed is appended to it
+	const string &checkpoint_filename = options.checkpoint_filename;
+	CheckpointReader checkpoint_reader;
+	CheckpointWriter checkpoint_writer;
+	int resume_degree = degree_start; // The first degree which is not in the checkpoint
+	if (!checkpoint_filename.empty()) {
+		unsigned long long fingerprint = ComputeModelFingerprint(cdga, diff, options);
+		if (checkpoint_reader.Open(checkpoint_filename, fingerprint) && checkpoint_reader.GetRecordCount() > 0 &&
+			checkpoint_reader.GetDegree(0) == degree_start && MatchesCheckpoint(checkpoint_reader, cdga, degree_start, category+1)) {
+			while (resume_degree <= degree_end && resume_degree-degree_start < checkpoint_reader.GetRecordCount() &&
+				checkpoint_reader.GetDegree(resume_degree-degree_start) == resume_degree) {
+				resume_degree++;
 			}
+		}
+		if (resume_degree > degree_start) {
+			cerr << "Reading degrees " << degree_start << " to " << resume_degree-1 << " from the checkpoint '" << checkpoint_filename << "'." << endl;
+		} else {
+			checkpoint_reader.Close();
+			if (!checkpoint_writer.Create(checkpoint_filename, fingerprint)) {
+				cerr << "Unable to write file '" << checkpoint_filename << "'." << endl;
+			}
+		}
+	}
 
-			int dim_prev = (int)basis[degree-1].size();
-			if (dim_prev == 0) {
-				// The image of d_{n-1} is zero, so it suffices to find the cocycles, because none of them will be boundaries
-				FindCocycleBasis(diff_matrix, dim_target, dim_source, cocycles_basis, basis[degree]);
-			} else {
-				// First, allocate memory for the differential of d : (deg n-1) ---> (deg n)
-				int **diff_matrix_prev = new int*[dim_source];
-				for (int i=0; i<dim_source; i++) {
-					diff_matrix_prev[i] = new int[dim_prev];
-				}
-			
-				// Then, compute the differential of d : (deg n-1) ---> (deg n)
-				diff.ComputeDifferentialMatrix(diff_matrix_prev, basis[degree-1], basis[degree]);
+	// With an extra grading, the matrices of the differentials are block diagonal, and the blocks are reduced on their own
+	ExtraGrading grading;
+	if (options.detect_grading) {
+		grading.Detect(cdga, diff);
+		if (grading.GetCount() > 0) {
+			cerr << "The differential respects " << grading.GetCount() << (grading.GetCount() == 1 ? " extra grading" : " extra gradings")
+				<< ", so the matrices are split into blocks." << endl;
+		}
+	}
 
-				// Finally, find a basis for the homology in degree n
+	// The degrees are computed with a rolling window, which only holds the bases and the differentials of one degree
+	HomologyWindow window(cdga, diff, category+1, grading, options.threads);
+	if (resume_degree == degree_start) {
+		PROFILE_DEGREE(degree_start-1);
+		window.Start(degree_start);
+	}
+	
+	for (int degree = degree_start; degree <= degree_end; degree++) {
+		OrderedLCBasis cocycles_basis, image_basis;
+		bool resumed = (degree < resume_degree);
+		if (resumed) {
+			// This degree was done by an earlier run
+			checkpoint_reader.ReadHomology(degree-degree_start, cocycles_basis, cdga.GetGeneratorRegistry());
+		} else {
+			// Here we compute a cocycles basis in the specified degree
+			PROFILE_DEGREE(degree);
+			window.Move(degree);
+			if (!window.GetSource().empty()) {
 				cerr << "Degree: " << degree << endl;
-				FindHomologyBasis(diff_matrix_prev, dim_source, dim_prev, diff_matrix, dim_target, dim_source, cocycles_basis, image_basis, basis[degree]);
-			
-				// Free up memory
-				for (int i=0; i<dim_source; i++) {
-					delete [] diff_matrix_prev[i];
-				}
-				delete [] diff_matrix_prev;
 			}
-		
-			// Free up memory used for the matrix
-			if (diff_matrix) {
-				for (int i=0; i<dim_target; i++) {
-					delete [] diff_matrix[i];
-				}
-				delete [] diff_matrix;
+			window.Reduce(cocycles_basis, image_basis);
+			if (checkpoint_writer.IsOpen() && !checkpoint_writer.Write(degree, window.GetSource(), window.GetMatrix(), window.GetReduction(), cocycles_basis)) {
+				cerr << "Unable to write the checkpoint '" << checkpoint_filename << "'." << endl;
+				checkpoint_writer.Close();
 			}
 		}
 
 		int homology_dim = (int)cocycles_basis.size();
 		int boundaries_dim = (int)image_basis.size();
-		//cout << "The homology has dimension " << homology_dim << ". " << endl << endl;
+		//out << "The homology has dimension " << homology_dim << ". " << endl << endl;
 	
-		cout << "HOMOLOGY DEGREE " << degree << " (DIM " << homology_dim << "):" << endl << endl;
+		out << "HOMOLOGY DEGREE " << degree << " (DIM " << homology_dim << "):" << endl << endl;
 
 		if (homology_dim > 0) {
 			OrderedLCBasis::iterator iter;
-			//cout << "Here is a basis of cocycles:" << endl << endl;
+			//out << "Here is a basis of cocycles:" << endl << endl;
 			for (iter = cocycles_basis.begin(); iter != cocycles_basis.end(); iter++) {
-				cout << iter->OutputString() << endl;
+				out << iter->OutputString() << endl;
 			}
 
 			// This only makes senses if homology is being computed for one degree and not a range of degree.
 			// So we only output this information for degree == degree_start.
-			if (!extension_output_filename.empty() && degree == degree_start) {
-				ofstream extension_file(extension_output_filename);
+			if (!extension_output_filename.empty() && degree == degree_start && !pipeline) {
+				ostringstream extension_file;
 				extension_file << "The homology in degree " << degree << " has dimension " << homology_dim << " and hence can be killed by introducing the following generators:" << endl << endl;
 				extension_file << "Extension:" << endl;
 				int index = 0;
@@ -197,51 +491,267 @@ void RunTest1(const string &input_filename, ofstream &output)
 					ss << setfill('0') << setw(num_digits) << ++index;
 					extension_file << "d(" << "�_" + ss.str() << ") = " << iter->OutputString() << endl;
 				}
-				extension_file.close();
+				if (!WriteFileAtomically(extension_output_filename, extension_file.str())) {
+					cerr << "Unable to write file '" << extension_output_filename << "'." << endl;
+				}
 			}
 
-			cout << endl;
+			out << endl;
+
+			if (pipeline) {
+				// Kill the homology, then append the new words of X^{n+1}. The image of d_n, which is carried over to
+				// degree n+1, keeps its coordinates.
+				int first_generator = cdga.GetExtensionSpace().GetDimension();
+				ostringstream extension, differential;
+				KillHomology(cdga, diff, cocycles_basis, degree, extension, differential);
+				// The cocycles come from the blocks, so the new generators get weights and the gradings carry on
+				if (options.detect_grading) {
+					grading.Detect(cdga, diff);
+				}
+				out << "The homology was killed by the following generators:" << endl << endl;
+				out << extension.str() << endl << differential.str() << endl;
+				pipeline_extension << extension.str();
+				pipeline_differential << differential.str();
+
+				if (!resumed) {
+					window.ExtendTarget(first_generator);
+				}
+			}
+		}
+
+		if (degree == resume_degree-1 && degree < degree_end) {
+			// This is the last degree read from the checkpoint: set up the window as the earlier run left it (with the
+			// generators added by the pipeline so far), then carry on the checkpoint
+			ReducedDifferential reduced;
+			checkpoint_reader.ReadReduction(degree-degree_start, reduced, cdga.GetGeneratorRegistry());
+			window.Resume(degree, reduced);
+			unsigned long long valid_size = checkpoint_reader.GetValidSize();
+			checkpoint_reader.Close();
+			if (!checkpoint_writer.Continue(checkpoint_filename, valid_size)) {
+				cerr << "Unable to write file '" << checkpoint_filename << "'." << endl;
+			}
 		}
 
 		/*
 		// For now I'm commenting this block out. I don't think it's useful to know the image of d.
 		if (boundaries_dim > 0) {
 			OrderedLCBasis::iterator iter;
-			cout << "Here is a basis for the image of d_" << degree-1 << ":" << endl << endl;
+			out << "Here is a basis for the image of d_" << degree-1 << ":" << endl << endl;
 			for (iter = image_basis.begin(); iter != image_basis.end(); iter++) {
-				cout << iter->OutputString() << endl;
+				out << iter->OutputString() << endl;
 			}
-			cout << endl;
+			out << endl;
 		}*/
 	}
 
-	cout << "Here is a basis of the extended cdga from degree 0 up to degree " << degree_end+1 << "." << endl << endl;
+	if (pipeline && !extension_output_filename.empty()) {
+		ostringstream extension_file;
+		extension_file << "Extension:" << endl << pipeline_extension.str() << endl;
+		extension_file << "Differential:" << endl << pipeline_differential.str();
+		if (!WriteFileAtomically(extension_output_filename, extension_file.str())) {
+			cerr << "Unable to write file '" << extension_output_filename << "'." << endl;
+		}
+	}
+
+	// Release the window before listing the bases, which are enumerated one word at a time
+	window.Clear();
+
+	out << "Here is a basis of the extended cdga from degree 0 up to degree " << degree_end+1 << "." << endl << endl;
 	for (int deg=0; deg<=degree_end+1; deg++) {
-		int dim = basis[deg].size();
-		int i = 0;
-		cout << "DEGREE " << deg << " (dim " << dim << "):" << endl;
-		OrderedBasis::iterator iter;
+		// The dimension comes first, so it is counted by a first pass over the words
+		BasisIterator words(cdga, deg, category+1, true);
+		Word word;
+		int dim = 0;
+		while (words.Next(word))
+			dim++;
+		out << "DEGREE " << deg << " (dim " << dim << "):" << endl;
+		words.Reset();
 		int minLength = -1;
 		int maxLength = 0;
-		for (iter = basis[deg].begin(); iter != basis[deg].end(); iter++) {
+		for (int i=0; words.Next(word); i++) {
 			if (i>0)
-				cout << ", ";
-			if (iter->GetLength() < minLength || minLength == -1)
-				minLength = iter->GetLength();
-			if (iter->GetLength() > maxLength)
-				maxLength = iter->GetLength();
-			cout << iter->OutputString();
-			i++;
+				out << ", ";
+			if (word.GetLength() < minLength || minLength == -1)
+				minLength = word.GetLength();
+			if (word.GetLength() > maxLength)
+				maxLength = word.GetLength();
+			out << word.OutputString();
 		}
-		cout << endl;
+		out << endl;
 		if (dim > 0) {
-			cout << "Min word length: " << minLength << endl;
-			cout << "Max word length: " << maxLength << endl;
+			out << "Min word length: " << minLength << endl;
+			out << "Max word length: " << maxLength << endl;
 		}
-		cout << endl;
+		out << endl;
 	}
 
-	cout << endl;
+	out << endl;
+	return true;
+}
+
+void RunTest1(const string &input_filename, ofstream &output)
+{
+	FreeCGA cdga;
+	Differential diff;
+	OutputOptions options;
+
+	if (!ReadModel(input_filename, cdga, diff, options)) {
+		return;
+	}
+
+	const string &output_filename = options.output_filename;
+	if (!output_filename.empty()) {
+		output.open(output_filename);
+		cout << "Redirecting all output to '" << output_filename << "'..." << endl;
+		// Make cout redirect to "output"
+		buffer = cout.rdbuf();
+		cout.rdbuf(output.rdbuf());
+	}
+
+	ComputeModel(input_filename, cdga, diff, options, cout);
+}
+
+// The outcome of one model of a batch
+struct BatchResult
+{
+	BatchResult() : status("not run"), milliseconds(0) {}
+
+	string input_filename;
+	string output_filename;
+	string status;
+	double milliseconds;
+};
+
+// The input file of the model which the thread is running in a batch, and the message it is writing to cerr
+static thread_local string batch_model;
+static thread_local string batch_message;
+
+// While a batch runs, cerr writes to this buffer, which starts every line with the name of the input file of the
+// model which wrote it, and passes on whole lines only, so that the messages of the workers don't mix
+class BatchMessageBuffer : public streambuf
+{
+public:
+	BatchMessageBuffer(streambuf *_destination) : destination(_destination) {}
+
+protected:
+	virtual int overflow(int c)
+	{
+		if (c == traits_type::eof()) {
+			return traits_type::not_eof(c);
+		}
+		batch_message += (char)c;
+		if (c == '\n') {
+			string line = batch_model.empty() ? batch_message : batch_model + ": " + batch_message;
+			lock_guard<mutex> guard(lock);
+			destination->sputn(line.data(), (streamsize)line.size());
+			batch_message.clear();
+		}
+		return c;
+	}
+
+private:
+	streambuf *destination;
+	mutex lock;
+};
+
+// Run a single model of a batch. All of the output of the model is kept in memory, then written at once to the file
+// named by the model, or to the input file followed by ".out" if it doesn't name one, so that a result file is either
+// complete or absent.
+static void RunBatchModel(BatchResult &result)
+{
+	chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+	batch_model = result.input_filename;
+	try {
+		FreeCGA cdga;
+		Differential diff;
+		OutputOptions options;
+		if (ReadModel(result.input_filename, cdga, diff, options)) {
+			result.output_filename = options.output_filename.empty() ? result.input_filename + ".out" : options.output_filename;
+			ostringstream out;
+			bool computed = ComputeModel(result.input_filename, cdga, diff, options, out);
+			out << "Time elapsed: " << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - begin).count() << " milliseconds." << endl;
+			if (!WriteFileAtomically(result.output_filename, out.str())) {
+				cerr << "Unable to write file '" << result.output_filename << "'." << endl;
+				result.status = "unwritable";
+			} else {
+				result.status = computed ? "ok" : "refused";
+			}
+		} else {
+			result.status = "invalid";
+		}
+	} catch (exception &e) {
+		cerr << "An exception has occured: " << e.what() << endl;
+		result.status = "failed";
+	}
+	batch_model.clear();
+	result.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+}
+
+// Read the names of the input files listed in a manifest, one per line. Empty lines and lines starting with '#' are
+// skipped. Returns false if the manifest can't be opened.
+static bool ReadManifest(const string &manifest_filename, vector<string> &input_filenames)
+{
+	ifstream file(manifest_filename);
+	if (!file.is_open()) {
+		return false;
+	}
+	string line;
+	while (getline(file, line)) {
+		size_t start = line.find_first_not_of(" \t\r");
+		if (start == string::npos || line[start] == '#') {
+			continue;
+		}
+		size_t end = line.find_last_not_of(" \t\r");
+		input_filenames.push_back(line.substr(start, end - start + 1));
+	}
+	return true;
+}
+
+// Run the models of a batch on "workers" threads, which take the models in turn, then output a table with the outcome
+// and the time of every model. Returns the number of models which didn't complete.
+static int RunBatch(const vector<string> &input_filenames, int workers)
+{
+	vector<BatchResult> results(input_filenames.size());
+	for (size_t i=0; i<input_filenames.size(); i++) {
+		results[i].input_filename = input_filenames[i];
+	}
+
+	BatchMessageBuffer messages(cerr.rdbuf());
+	streambuf *cerr_buffer = cerr.rdbuf(&messages);
+
+	chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+	atomic<size_t> next_model(0);
+	vector<thread> threads;
+	for (int t=0; t<workers; t++) {
+		threads.push_back(thread([&]() {
+			size_t model;
+			while ((model = next_model++) < results.size()) {
+				RunBatchModel(results[model]);
+			}
+		}));
+	}
+	for (int t=0; t<workers; t++) {
+		threads[t].join();
+	}
+	cerr.rdbuf(cerr_buffer);
+	double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+
+	size_t width = strlen("MODEL");
+	for (size_t i=0; i<results.size(); i++) {
+		width = max(width, results[i].input_filename.size());
+	}
+	int failures = 0;
+	cout << endl << left << setw((int)width + 2) << "MODEL" << setw(12) << "STATUS" << right << setw(12) << "TIME (MS)" << "  OUTPUT" << endl;
+	vector<BatchResult>::const_iterator iter;
+	for (iter = results.begin(); iter != results.end(); iter++) {
+		cout << left << setw((int)width + 2) << iter->input_filename << setw(12) << iter->status << right << setw(12)
+			<< (long long)iter->milliseconds << "  " << iter->output_filename << endl;
+		if (iter->status != "ok")
+			failures++;
+	}
+	cout << endl << results.size() - failures << " of " << results.size() << " models completed on " << workers
+		<< (workers == 1 ? " worker in " : " workers in ") << (long long)milliseconds << " milliseconds." << endl;
+	return failures;
 }
 
 void RunTest2()
@@ -261,13 +771,14 @@ void RunTest2()
 	X.AddGenerator("attention", 5);
 	X.AddGenerator("gamma", 5);
 	X.AddGenerator("yo_man_21", 5);
-	Word w1, w2, w3;
+	const GeneratorRegistry *registry = &X.GetGeneratorRegistry();
+	Word w1(registry), w2(registry), w3(registry);
 	file >> w1 >> w2 >> w3;
 	cout << w1 << endl
 		<< w2 << endl
 		<< w3 << endl;
 
-	LinearCombination lc;
+	LinearCombination lc(registry);
 	file >> lc;
 	cout << "Linear combination is: " << lc << endl;
 }
@@ -278,10 +789,52 @@ void RunTest3()
 
 int main(int argc, char **argv)
 {
-	atexit(pause);
-
 	cout << "Welcome to cdga-generators! Written by Philippe Paradis (June 2011)." << endl;
 
+	if (argc >= 2 && string(argv[1]) == "-batch") {
+		// Batch mode: no question is asked and the program doesn't pause at exit
+		vector<string> input_filenames;
+		int workers = (int)thread::hardware_concurrency();
+		for (int i=2; i<argc; i++) {
+			string arg = argv[i];
+			if (arg == "-workers" && i+1 < argc) {
+				stringstream ss(argv[++i]);
+				if (!(ss >> workers) || workers < 0) {
+					cerr << "The specified number of workers is invalid." << endl;
+					return 1;
+				}
+			} else if (arg == "-manifest" && i+1 < argc) {
+				if (!ReadManifest(argv[++i], input_filenames)) {
+					cerr << "Unable to open manifest '" << argv[i] << "'." << endl;
+					return 1;
+				}
+			} else {
+				input_filenames.push_back(arg);
+			}
+		}
+		if (input_filenames.empty()) {
+			cerr << "Usage: cdga-generators -batch [-workers n] [-manifest file] [file ...]" << endl;
+			return 1;
+		}
+		if (workers == 0) {
+			workers = max(1, (int)thread::hardware_concurrency());
+		}
+		workers = max(1, min(workers, (int)input_filenames.size()));
+#ifdef CDGA_PROFILE
+		// The profiler records the phases of one degree at a time, so the models must not run concurrently
+		if (workers > 1) {
+			cerr << "The models are run on a single worker, since the phases are being profiled." << endl;
+			workers = 1;
+		}
+#endif
+		int failures = RunBatch(input_filenames, workers);
+		// In a build with CDGA_PROFILE defined, the phases of all the models of the batch are reported together
+		PROFILE_REPORT("batch.profile.json");
+		return failures == 0 ? 0 : 1;
+	}
+
+	atexit(pause);
+
 	ofstream output;
 	string input_filename;
 
@@ -292,18 +845,23 @@ int main(int argc, char **argv)
 		getline(cin, input_filename);
 	}
 	
-	DWORD timeBegin = GetTickCount();
+	chrono::steady_clock::time_point timeBegin = chrono::steady_clock::now();
 
 	try {
 		RunTest1(input_filename, output);
 		//RunTest3();
-	} catch (logic_error &e) {
+	} catch (exception &e) {
 		cerr << "An exception has occured: " << e.what() << endl;
 	}
 
-	DWORD timeEnd = GetTickCount();
-	cout << "Time elapsed: " << (int)(timeEnd - timeBegin) << " milliseconds." << endl;
+	chrono::steady_clock::time_point timeEnd = chrono::steady_clock::now();
+	// In a build with CDGA_PROFILE defined, the time spent in each phase of each degree is reported next to the input file
+	PROFILE_REPORT(input_filename + ".profile.json");
+	cout << "Time elapsed: " << (int)chrono::duration_cast<chrono::milliseconds>(timeEnd - timeBegin).count() << " milliseconds." << endl;
 	cout.rdbuf(buffer);
+	// The counters depend on what was computed and what was read from a checkpoint, so they are kept out of the results
+	cerr << "Heap allocations: " << AllocationCounters::array_allocations << " by words, "
+		<< AllocationCounters::pool_allocations << " by pools (" << AllocationCounters::pool_releases << " releases)." << endl;
 
 	return 0;
 }
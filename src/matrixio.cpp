@@ -0,0 +1,338 @@
+#include "matrixio.h"
+
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+static const char MATRIX_TAG[8] = { 'C', 'D', 'G', 'A', 'C', 'S', 'C', '1' };
+static const unsigned int MATRIX_VERSION = 1;
+static const unsigned int BYTE_ORDER_MARK = 0x01020304;
+
+static const char MATRIX_MARKET_BANNER[] = "%%MatrixMarket matrix coordinate integer general";
+// The width of the line with the dimensions, which is enough for three 64-bit integers
+static const int DIMENSIONS_WIDTH = 63;
+
+// The header of a matrix in the binary format
+struct MatrixHeader
+{
+	char tag[8];
+	unsigned int version;
+	unsigned int byte_order;
+	long long rows;
+	long long cols;
+	long long nonzeros;
+};
+
+MatrixWriter::MatrixWriter()
+{
+	format = MATRIX_BINARY;
+	rows = 0;
+	cols = 0;
+	nonzeros = 0;
+}
+
+bool MatrixWriter::Open(const string &filename, MATRIX_FORMAT _format, long long _rows)
+{
+	file.close();
+	file.clear();
+	format = _format;
+	rows = _rows;
+	cols = 0;
+	nonzeros = 0;
+	col_starts.assign(1, 0);
+
+	// The binary mode keeps the line ends of a Matrix Market file as they are, so that the line with the dimensions
+	// can be overwritten in place
+	file.open(filename, ios::binary | ios::trunc);
+	if (!file.is_open()) {
+		return false;
+	}
+	if (format == MATRIX_BINARY) {
+		// The dimensions are written when the file is closed
+		MatrixHeader header;
+		memset(&header, 0, sizeof(header));
+		dimensions_pos = file.tellp();
+		file.write((const char *)&header, sizeof(header));
+	} else {
+		file << MATRIX_MARKET_BANNER << "\n";
+		file << "% The matrix of a differential, computed by cdga-generators\n";
+		dimensions_pos = file.tellp();
+		file << string(DIMENSIONS_WIDTH, ' ') << "\n";
+	}
+	return file.good();
+}
+
+void MatrixWriter::WriteEntry(long long row, long long value)
+{
+	if (format == MATRIX_BINARY) {
+		file.write((const char *)&row, sizeof(row));
+		file.write((const char *)&value, sizeof(value));
+	} else {
+		char line[80];
+		int length = snprintf(line, sizeof(line), "%lld %lld %lld\n", row+1, cols+1, value);
+		file.write(line, length);
+	}
+	nonzeros++;
+}
+
+void MatrixWriter::WriteBigEntry(long long row, const Coefficient &value)
+{
+	if (format == MATRIX_BINARY) {
+		throw logic_error("The matrix has a coefficient which doesn't fit in 64 bits. Use 'matrix-format = market' to write it.");
+	}
+	file << row+1 << " " << cols+1 << " " << value << "\n";
+	nonzeros++;
+}
+
+void MatrixWriter::AppendColumn(const SparseVector &column)
+{
+	SparseVector::const_iterator iter;
+	for (iter = column.begin(); iter != column.end(); iter++) {
+		WriteEntry(iter->first, iter->second);
+	}
+	if (format == MATRIX_BINARY) {
+		col_starts.push_back(nonzeros);
+	}
+	cols++;
+}
+
+void MatrixWriter::AppendColumns(const SparseMatrix &m)
+{
+	for (long long j=0; j<m.GetCols(); j++) {
+		for (long long k=m.ColumnBegin(j); k<m.ColumnEnd(j); k++) {
+			if (m.IsBig(k)) {
+				WriteBigEntry(m.RowIndex(k), m.GetCoefficient(k));
+			} else {
+				WriteEntry(m.RowIndex(k), m.Value(k));
+			}
+		}
+		if (format == MATRIX_BINARY) {
+			col_starts.push_back(nonzeros);
+		}
+		cols++;
+	}
+}
+
+bool MatrixWriter::Close()
+{
+	if (!file.is_open()) {
+		return false;
+	}
+	if (format == MATRIX_BINARY) {
+		file.write((const char *)col_starts.data(), col_starts.size() * sizeof(long long));
+		vector<long long>().swap(col_starts);
+
+		MatrixHeader header;
+		memcpy(header.tag, MATRIX_TAG, sizeof(MATRIX_TAG));
+		header.version = MATRIX_VERSION;
+		header.byte_order = BYTE_ORDER_MARK;
+		header.rows = rows;
+		header.cols = cols;
+		header.nonzeros = nonzeros;
+		file.seekp(dimensions_pos);
+		file.write((const char *)&header, sizeof(header));
+	} else {
+		file.seekp(dimensions_pos);
+		file << rows << " " << cols << " " << nonzeros;
+	}
+	file.close();
+	bool written = !file.fail();
+	file.clear();
+	return written;
+}
+
+// Reads the numbers of a Matrix Market file from its mapping, which isn't terminated by a null character
+class MatrixMarketParser
+{
+public:
+	MatrixMarketParser(const char *_pos, const char *_end) : pos(_pos), end(_end) {}
+
+	// Return true if the next line starts with "prefix", and move to the next line if it does
+	bool SkipLine(const char *prefix)
+	{
+		size_t length = strlen(prefix);
+		if ((size_t)(end - pos) < length || memcmp(pos, prefix, length) != 0) {
+			return false;
+		}
+		while (pos != end && *pos != '\n') {
+			pos++;
+		}
+		if (pos != end) {
+			pos++;
+		}
+		return true;
+	}
+
+	bool GetNumber(long long &value)
+	{
+		while (pos != end && (*pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == '\n')) {
+			pos++;
+		}
+		bool negative = false;
+		if (pos != end && (*pos == '-' || *pos == '+')) {
+			negative = (*pos++ == '-');
+		}
+		if (pos == end || *pos < '0' || *pos > '9') {
+			return false;
+		}
+		unsigned long long magnitude = 0;
+		for (; pos != end && *pos >= '0' && *pos <= '9'; pos++) {
+			if (magnitude > (0x7fffffffffffffffULL - (*pos - '0')) / 10) {
+				return false;
+			}
+			magnitude = magnitude * 10 + (*pos - '0');
+		}
+		value = negative ? -(long long)magnitude : (long long)magnitude;
+		return true;
+	}
+
+private:
+	const char *pos;
+	const char *end;
+};
+
+MappedMatrix::MappedMatrix()
+{
+	rows = 0;
+	cols = 0;
+	nonzeros = 0;
+	entries = 0;
+	col_starts = 0;
+}
+
+MappedMatrix::~MappedMatrix()
+{
+	Close();
+}
+
+bool MappedMatrix::Open(const string &filename)
+{
+	Close();
+	if (!file.Open(filename)) {
+		return false;
+	}
+	bool opened = OpenBinary() || OpenMatrixMarket();
+	if (!opened) {
+		Close();
+	}
+	return opened;
+}
+
+bool MappedMatrix::OpenBinary()
+{
+	if (file.GetSize() < sizeof(MatrixHeader)) {
+		return false;
+	}
+	MatrixHeader header;
+	memcpy(&header, file.GetData(), sizeof(header));
+	if (memcmp(header.tag, MATRIX_TAG, sizeof(MATRIX_TAG)) != 0 || header.version != MATRIX_VERSION ||
+		header.byte_order != BYTE_ORDER_MARK || header.rows < 0 || header.cols < 0 || header.nonzeros < 0) {
+		return false;
+	}
+	// The header takes a multiple of 8 bytes and the mapping starts on a page, so the numbers are aligned. The counts
+	// are compared with the size of the file before they are multiplied, so that a corrupt header can't wrap around.
+	unsigned long long numbers = (file.GetSize() - sizeof(header)) / sizeof(long long);
+	if ((unsigned long long)header.nonzeros > numbers / 2 || (unsigned long long)header.cols >= numbers - 2*(unsigned long long)header.nonzeros ||
+		file.GetSize() != sizeof(header) + (2*(unsigned long long)header.nonzeros + (unsigned long long)header.cols + 1) * sizeof(long long)) {
+		return false;
+	}
+	rows = header.rows;
+	cols = header.cols;
+	nonzeros = header.nonzeros;
+	entries = (const long long *)(file.GetData() + sizeof(header));
+	col_starts = entries + 2*nonzeros;
+
+	// The accessors trust the positions of the columns and the row indices, so they are all checked here once
+	if (col_starts[0] != 0 || col_starts[cols] != nonzeros) {
+		return false;
+	}
+	for (long long j=0; j<cols; j++) {
+		if (col_starts[j+1] < col_starts[j]) {
+			return false;
+		}
+		for (long long k=col_starts[j]; k<col_starts[j+1]; k++) {
+			if (entries[2*k] < 0 || entries[2*k] >= rows || (k > col_starts[j] && entries[2*k] <= entries[2*k-2])) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool MappedMatrix::OpenMatrixMarket()
+{
+	MatrixMarketParser parser(file.GetData(), file.GetData() + file.GetSize());
+	if (!parser.SkipLine(MATRIX_MARKET_BANNER)) {
+		return false;
+	}
+	while (parser.SkipLine("%")) {
+	}
+	long long count;
+	if (!parser.GetNumber(rows) || !parser.GetNumber(cols) || !parser.GetNumber(count) || rows < 0 || cols < 0 || count < 0) {
+		return false;
+	}
+
+	// The entries are sorted by column, then each column is normalized like a column of a differential
+	vector<pair<long long, pair<long long, long long> > > triplets((size_t)count);
+	for (long long k=0; k<count; k++) {
+		long long i, j, value;
+		if (!parser.GetNumber(i) || !parser.GetNumber(j) || !parser.GetNumber(value) || i < 1 || i > rows || j < 1 || j > cols) {
+			return false;
+		}
+		triplets[(size_t)k] = make_pair(j-1, make_pair(i-1, value));
+	}
+	sort(triplets.begin(), triplets.end());
+
+	parsed_entries.clear();
+	parsed_col_starts.assign(1, 0);
+	SparseVector column;
+	size_t k = 0;
+	for (long long j=0; j<cols; j++) {
+		column.clear();
+		for (; k < triplets.size() && triplets[k].first == j; k++) {
+			column.push_back(triplets[k].second);
+		}
+		NormalizeSparseVector(column);
+		SparseVector::const_iterator iter;
+		for (iter = column.begin(); iter != column.end(); iter++) {
+			parsed_entries.push_back(iter->first);
+			parsed_entries.push_back(iter->second);
+		}
+		parsed_col_starts.push_back((long long)parsed_entries.size() / 2);
+	}
+
+	// Nothing is read from the mapping anymore
+	file.Close();
+	nonzeros = parsed_col_starts.back();
+	entries = parsed_entries.data();
+	col_starts = parsed_col_starts.data();
+	return true;
+}
+
+void MappedMatrix::Close()
+{
+	file.Close();
+	rows = 0;
+	cols = 0;
+	nonzeros = 0;
+	entries = 0;
+	col_starts = 0;
+	vector<long long>().swap(parsed_entries);
+	vector<long long>().swap(parsed_col_starts);
+}
+
+void MappedMatrix::Load(SparseMatrix &m) const
+{
+	m.Reset(rows);
+	SparseVector column;
+	for (long long j=0; j<cols; j++) {
+		column.clear();
+		for (long long k=ColumnBegin(j); k<ColumnEnd(j); k++) {
+			column.push_back(make_pair(RowIndex(k), Value(k)));
+		}
+		m.AppendColumn(column);
+	}
+}
@@ -0,0 +1,107 @@
+#ifndef _MATRIXIO__H
+#define _MATRIXIO__H
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "cdga.h"
+#include "sparse.h"
+#include "fileio.h"
+
+using namespace std;
+
+// The binary format stores a matrix column by column, like SparseMatrix: the columns of a differential are what is
+// computed one at a time, and a file which is written as they come can't be in row order. Since the matrix of
+// d_n : X^n ---> X^{n+1} has one column per word of X^n, this is also the CSR layout of the transpose of the matrix,
+// with one row per word (the layout of the lattice reduction, see homology.cpp).
+// The file starts with a header: the tag "CDGACSC1", the version of the format, a byte order mark, and the number of
+// rows, columns and non-zero entries (as 64-bit integers). Then come the entries, column by column and by increasing
+// row index in each column, as pairs (row index, value) of 64-bit integers, and finally the cols+1 positions at which
+// the columns start in the list of entries. The numbers are stored in the byte order of the machine.
+//
+// In the Matrix Market format, the line with the dimensions comes before the entries, whose number isn't known until
+// the last column. The line is therefore padded with spaces when the file is opened and filled in when it is closed.
+// The indices of a Matrix Market file start at 1.
+
+// Writes a matrix to a file one column at a time, so that a matrix can be written as it is computed without ever being
+// held in memory (see Differential::ComputeDifferentialMatrix). Only the starts of the columns are kept until the file
+// is closed.
+class MatrixWriter
+{
+public:
+	MatrixWriter();
+
+	// Create the file of a matrix with "rows" rows and no columns yet. Returns false if the file couldn't be created.
+	bool Open(const string &filename, MATRIX_FORMAT _format, long long _rows);
+	// Append a column to the right of the matrix. The vector must be normalized (see NormalizeSparseVector).
+	void AppendColumn(const SparseVector &column);
+	// Append the columns of "m", which must have as many rows as the matrix of the file
+	void AppendColumns(const SparseMatrix &m);
+	// Write the end of the file and the dimensions. Returns false if the file couldn't be written.
+	bool Close();
+
+	long long GetRows() const { return rows; }
+	long long GetCols() const { return cols; }
+	long long GetNonZeros() const { return nonzeros; }
+
+private:
+	// Write the entry in a given row of the column which comes after the last one
+	void WriteEntry(long long row, long long value);
+	// Same as above, for an entry which doesn't fit in 64 bits. Only the Matrix Market format can hold it.
+	void WriteBigEntry(long long row, const Coefficient &value);
+
+	ofstream file;
+	MATRIX_FORMAT format;
+	long long rows;
+	long long cols;
+	long long nonzeros;
+	vector<long long> col_starts; // Only used by the binary format
+	streampos dimensions_pos; // Where the dimensions are written when the file is closed
+};
+
+// A matrix read from a file written by a MatrixWriter, with the same accessors as a SparseMatrix. A file in the binary
+// format is mapped in memory and read in place, so it is never copied into memory. Opening it reads the file once, to
+// check that the positions of the columns never decrease and that the row indices are in range and increasing in each
+// column, so that a corrupt file is refused instead of being read out of bounds. A file in the Matrix Market format is parsed (from the mapping) into
+// memory. Any general matrix with integer entries in the coordinate format can be read this way, whatever the order of
+// its entries, as long as they fit in 64 bits.
+class MappedMatrix
+{
+public:
+	MappedMatrix();
+	~MappedMatrix();
+
+	// Open the file of a matrix. Returns false if the file doesn't exist or isn't a matrix in one of the two formats.
+	bool Open(const string &filename);
+	void Close();
+
+	long long GetRows() const { return rows; }
+	long long GetCols() const { return cols; }
+	long long GetNonZeros() const { return nonzeros; }
+
+	// The entries of column j are at positions ColumnBegin(j), ..., ColumnEnd(j)-1, by increasing row index
+	long long ColumnBegin(long long j) const { return col_starts[j]; }
+	long long ColumnEnd(long long j) const { return col_starts[j+1]; }
+	long long RowIndex(long long k) const { return entries[2*k]; }
+	long long Value(long long k) const { return entries[2*k+1]; }
+
+	// Copy the matrix into "m"
+	void Load(SparseMatrix &m) const;
+
+private:
+	bool OpenBinary();
+	bool OpenMatrixMarket();
+
+	MappedFile file;
+	long long rows;
+	long long cols;
+	long long nonzeros;
+	// Either in the mapping (binary format), or in the two arrays below (Matrix Market format)
+	const long long *entries;
+	const long long *col_starts;
+	vector<long long> parsed_entries;
+	vector<long long> parsed_col_starts;
+};
+
+#endif
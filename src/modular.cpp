@@ -0,0 +1,296 @@
+#include "modular.h"
+#include "pool.h"
+#include "profile.h"
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <assert.h>
+
+using namespace std;
+
+// A sparse vector with coefficients in Z/pZ, sorted by index
+typedef vector<pair<long long, unsigned long> > ModularVector;
+
+static unsigned long MulMod(unsigned long a, unsigned long b, unsigned long p)
+{
+	return (unsigned long)(((unsigned long long)a * b) % p);
+}
+
+static unsigned long PowMod(unsigned long a, unsigned long e, unsigned long p)
+{
+	unsigned long result = 1;
+	while (e > 0) {
+		if (e & 1)
+			result = MulMod(result, a, p);
+		a = MulMod(a, a, p);
+		e >>= 1;
+	}
+	return result;
+}
+
+// Return the inverse of a non-zero element of Z/pZ (by Fermat's little theorem)
+static unsigned long InverseMod(unsigned long a, unsigned long p)
+{
+	return PowMod(a, p-2, p);
+}
+
+// Miller-Rabin test with the bases 2, 7 and 61, which is deterministic for n < 4759123141
+static bool IsPrime(unsigned long n)
+{
+	if (n < 2)
+		return false;
+	const unsigned long bases[] = {2, 7, 61};
+	for (int i=0; i<3; i++) {
+		if (n == bases[i])
+			return true;
+		if (n % bases[i] == 0)
+			return false;
+	}
+
+	unsigned long d = n-1;
+	int s = 0;
+	while (d % 2 == 0) {
+		d /= 2;
+		s++;
+	}
+	for (int i=0; i<3; i++) {
+		unsigned long x = PowMod(bases[i], d, n);
+		if (x == 1 || x == n-1)
+			continue;
+		bool composite = true;
+		for (int r=1; r<s && composite; r++) {
+			x = MulMod(x, x, n);
+			if (x == n-1)
+				composite = false;
+		}
+		if (composite)
+			return false;
+	}
+	return true;
+}
+
+unsigned long GetRandomPrime()
+{
+	// Each call uses its own generator, so that this can be called from several threads at the same time
+	random_device device;
+	mt19937 generator(device());
+	uniform_int_distribution<unsigned long> distribution(1UL << 30, (1UL << 31) - 1);
+
+	unsigned long p;
+	do {
+		p = distribution(generator) | 1;
+	} while (!IsPrime(p));
+	return p;
+}
+
+// Replace "column" by column - c * pivot_column, where the pivot column has "pivot_size" entries. "sum" is only used to
+// hold the result, so that its capacity is reused.
+static void SubtractMultiple(ModularVector &column, unsigned long c, const ModularVector::value_type *pivot_column, size_t pivot_size, unsigned long p, ModularVector &sum)
+{
+	size_t a = 0, b = 0;
+	sum.clear();
+	while (a < column.size() || b < pivot_size) {
+		if (b == pivot_size || (a < column.size() && column[a].first < pivot_column[b].first)) {
+			sum.push_back(column[a++]);
+		} else {
+			unsigned long value = (p - MulMod(c, pivot_column[b].second, p)) % p;
+			long long index = pivot_column[b].first;
+			if (a < column.size() && column[a].first == index) {
+				value = (value + column[a++].second) % p;
+			}
+			b++;
+			if (value != 0)
+				sum.push_back(make_pair(index, value));
+		}
+	}
+	column.swap(sum);
+}
+
+long long ComputeRankModP(const SparseMatrix &m, unsigned long p)
+{
+	assert(p > 2 && p < (1UL << 31));
+
+	// Each reduced column is stored with its last entry (the "pivot") equal to 1. "pivot_columns" maps each row to
+	// the reduced column having its pivot in that row, if there is one. The reduced columns are stored back to back
+	// in a pool, and the working columns keep their capacity, so there is no allocation per column.
+	vector<long long> pivot_columns(m.GetRows(), -1);
+	ListPool<ModularVector::value_type> reduced;
+	ModularVector column, sum;
+
+	for (long long j=0; j<m.GetCols(); j++) {
+		column.clear();
+		for (long long k=m.ColumnBegin(j); k<m.ColumnEnd(j); k++) {
+			unsigned long value = m.GetResidue(k, p);
+			if (value != 0)
+				column.push_back(make_pair(m.RowIndex(k), value));
+		}
+
+		// Eliminate the last entry of the column until it becomes zero or its last entry is in a new pivot row
+		while (!column.empty()) {
+			long long row = column.back().first;
+			long long pivot = pivot_columns[row];
+			if (pivot < 0) {
+				unsigned long inverse = InverseMod(column.back().second, p);
+				ModularVector::iterator iter;
+				for (iter = column.begin(); iter != column.end(); iter++) {
+					iter->second = MulMod(iter->second, inverse, p);
+				}
+				pivot_columns[row] = reduced.Add(column);
+				break;
+			}
+
+			// Compute column - c * reduced[pivot], which cancels the last entry
+			SubtractMultiple(column, column.back().second, reduced.Begin((int)pivot), reduced.GetSize((int)pivot), p, sum);
+		}
+	}
+
+	return (long long)reduced.GetCount();
+}
+
+long long ComputeRank(const SparseMatrix &m, int agreement)
+{
+	if (m.IsZero()) {
+		return 0;
+	}
+	PROFILE_SCOPE(PHASE_KERNEL);
+
+	long long rank = -1;
+	int count = 0;
+	while (count < agreement) {
+		long long rank_p = ComputeRankModP(m, GetRandomPrime());
+		PROFILE_COUNT(PHASE_KERNEL, m.GetCols());
+		if (rank_p > rank) {
+			// Every prime before this one was unlucky
+			rank = rank_p;
+			count = 1;
+		} else if (rank_p == rank) {
+			count++;
+		}
+	}
+	return rank;
+}
+
+// Sorts indices by increasing level, and by increasing index among those of the same level
+struct LevelOrder
+{
+	LevelOrder(const vector<int> &_levels) : levels(_levels) {}
+	bool operator()(long long i, long long j) const { return levels[i] < levels[j] || (levels[i] == levels[j] && i < j); }
+	const vector<int> &levels;
+};
+
+void ReduceFilteredMatrixModP(const SparseMatrix &m, const vector<int> &source_levels, const vector<int> &target_levels, unsigned long p, vector<long long> &pairs)
+{
+	assert(p > 2 && p < (1UL << 31));
+	assert((long long)source_levels.size() == m.GetCols() && (long long)target_levels.size() == m.GetRows());
+	pairs.assign((size_t)m.GetCols(), -1);
+
+	// The rows are numbered by increasing level, so the first entry of a column is the one of lowest level, and the
+	// columns are reduced by decreasing level, each one only with the columns reduced before it
+	vector<long long> rows((size_t)m.GetRows());
+	iota(rows.begin(), rows.end(), 0LL);
+	sort(rows.begin(), rows.end(), LevelOrder(target_levels));
+	vector<long long> positions((size_t)m.GetRows());
+	for (size_t k=0; k<rows.size(); k++) {
+		positions[(size_t)rows[k]] = (long long)k;
+	}
+	vector<long long> columns((size_t)m.GetCols());
+	iota(columns.begin(), columns.end(), 0LL);
+	sort(columns.begin(), columns.end(), LevelOrder(source_levels));
+	reverse(columns.begin(), columns.end());
+
+	// The columns which are still to be reduced, stored back to back in the order in which they are reduced. The
+	// columns which are put off to a later page are copied to the other pool.
+	ListPool<ModularVector::value_type> pending[2];
+	vector<long long> pending_columns[2];
+	ModularVector column, sum;
+	for (size_t k=0; k<columns.size(); k++) {
+		long long j = columns[k];
+		column.clear();
+		for (long long e=m.ColumnBegin(j); e<m.ColumnEnd(j); e++) {
+			unsigned long value = m.GetResidue(e, p);
+			if (value != 0)
+				column.push_back(make_pair(positions[(size_t)m.RowIndex(e)], value));
+		}
+		if (column.empty()) {
+			continue;
+		}
+		sort(column.begin(), column.end());
+		pending[0].Add(column);
+		pending_columns[0].push_back(j);
+	}
+
+	// As in ComputeRankModP, each reduced column is stored with its pivot equal to 1, but the pivot is now the first
+	// entry of the column
+	vector<long long> pivot_columns((size_t)m.GetRows(), -1);
+	ListPool<ModularVector::value_type> reduced;
+	int current = 0;
+	int gap = 0;
+	while (!pending_columns[current].empty()) {
+		// On the page "gap", a column can only be paired with a row whose level exceeds its own by "gap". The first entry
+		// of a column only moves to higher levels as the column is reduced, so a column whose first entry is further
+		// away is put off, and the next page is the one of the nearest first entry left.
+		int next = 1 - current;
+		pending[next].Clear();
+		pending_columns[next].clear();
+		int next_gap = -1;
+		for (int k=0; k<(int)pending_columns[current].size(); k++) {
+			long long j = pending_columns[current][k];
+			column.assign(pending[current].Begin(k), pending[current].End(k));
+			while (!column.empty()) {
+				long long row = rows[(size_t)column.front().first];
+				int distance = target_levels[(size_t)row] - source_levels[(size_t)j];
+				if (distance < gap) {
+					throw logic_error("Fatal error. The differential lowers the filtration.");
+				}
+				if (distance > gap) {
+					pending[next].Add(column);
+					pending_columns[next].push_back(j);
+					next_gap = (next_gap < 0) ? distance : min(next_gap, distance);
+					break;
+				}
+				long long pivot = pivot_columns[(size_t)column.front().first];
+				if (pivot < 0) {
+					unsigned long inverse = InverseMod(column.front().second, p);
+					ModularVector::iterator iter;
+					for (iter = column.begin(); iter != column.end(); iter++) {
+						iter->second = MulMod(iter->second, inverse, p);
+					}
+					pivot_columns[(size_t)column.front().first] = reduced.Add(column);
+					pairs[(size_t)j] = row;
+					break;
+				}
+				// Compute column - c * reduced[pivot], which cancels the first entry
+				SubtractMultiple(column, column.front().second, reduced.Begin((int)pivot), reduced.GetSize((int)pivot), p, sum);
+			}
+		}
+		current = next;
+		gap = next_gap;
+	}
+}
+
+void ReduceFilteredMatrix(const SparseMatrix &m, const vector<int> &source_levels, const vector<int> &target_levels, vector<long long> &pairs, int agreement)
+{
+	pairs.assign((size_t)m.GetCols(), -1);
+	if (m.IsZero()) {
+		return;
+	}
+	PROFILE_SCOPE(PHASE_KERNEL);
+
+	// As in ComputeRank, the pairs of an unlucky prime have a lower rank, or are different pairs of the same rank
+	long long rank = -1;
+	int count = 0;
+	vector<long long> pairs_p;
+	while (count < agreement) {
+		ReduceFilteredMatrixModP(m, source_levels, target_levels, GetRandomPrime(), pairs_p);
+		PROFILE_COUNT(PHASE_KERNEL, m.GetCols());
+		long long rank_p = (long long)(pairs_p.size() - count_if(pairs_p.begin(), pairs_p.end(), [](long long row) { return row < 0; }));
+		if (rank_p > rank || (rank_p == rank && pairs_p != pairs)) {
+			rank = rank_p;
+			pairs.swap(pairs_p);
+			count = 1;
+		} else if (rank_p == rank) {
+			count++;
+		}
+	}
+}
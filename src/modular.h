@@ -0,0 +1,42 @@
+#ifndef _MODULAR__H
+#define _MODULAR__H
+
+#include <vector>
+
+#include "sparse.h"
+
+using namespace std;
+
+// This is a rank engine working over prime fields Z/pZ with word-size primes p < 2^31, so every coefficient fits in
+// a machine word and no lattice reduction is needed. It is meant for computations which only need the dimension of the
+// homology (the Betti numbers), not a basis of it.
+
+// Return a random prime p with 2^30 < p < 2^31
+unsigned long GetRandomPrime();
+
+// Return the rank of "m" over Z/pZ, where p must be a prime smaller than 2^31.
+// The matrix is reduced column by column with sparse Gaussian elimination.
+long long ComputeRankModP(const SparseMatrix &m, unsigned long p);
+
+// The rank of an integer matrix over Q is at least its rank modulo any prime p, and both are equal unless p divides
+// every maximal non-zero minor of the matrix, which only happens for finitely many primes. This method computes the rank
+// modulo random 31-bit primes until "agreement" of them have returned the same largest rank, and returns that rank.
+long long ComputeRank(const SparseMatrix &m, int agreement = 3);
+
+// Reduce a filtered matrix modulo p. Each row and each column has a level, and the matrix never lowers it: an entry in
+// row i of column j has target_levels[i] >= source_levels[j] (the word lengths of the bases of a differential which
+// never shortens a word, for example). The columns are reduced by decreasing level, each one only with columns of
+// higher or equal level, until the entry of lowest level of each column (its pivot) is in a row of its own. The pairs
+// (column, pivot row) are then the same for any such reduction, and a pair whose levels differ by r is the
+// differential d_r of the spectral sequence of the filtration (see LengthSpectralSequence in spectral.h).
+// The reduction goes page by page: the pairs at distance 0 are found first, then those at distance 1, and so on, and a
+// column whose pivot is further away is put off to a later page without being touched.
+// The method sets pairs[j] to the row paired with column j, or to -1 if column j reduces to zero. Throws a logic_error
+// if the matrix lowers the level.
+void ReduceFilteredMatrixModP(const SparseMatrix &m, const vector<int> &source_levels, const vector<int> &target_levels, unsigned long p, vector<long long> &pairs);
+
+// Same as above, modulo random 31-bit primes until "agreement" of them have returned the same pairs of the largest
+// rank, which are then the pairs over Q
+void ReduceFilteredMatrix(const SparseMatrix &m, const vector<int> &source_levels, const vector<int> &target_levels, vector<long long> &pairs, int agreement = 2);
+
+#endif
@@ -0,0 +1,194 @@
+#include "planner.h"
+#include <algorithm>
+#include <climits>
+#include <assert.h>
+
+using namespace std;
+
+// The dimensions grow exponentially with the degree, so the counts saturate at LLONG_MAX instead of overflowing
+static long long AddCounts(long long a, long long b)
+{
+	return (a > LLONG_MAX - b) ? LLONG_MAX : a + b;
+}
+
+static long long MultiplyCounts(long long a, long long b)
+{
+	if (a == 0 || b == 0)
+		return 0;
+	return (a > LLONG_MAX / b) ? LLONG_MAX : a * b;
+}
+
+PoincareSeries::PoincareSeries(const FreeCGA &cdga, const Differential &differential, int _maxDegree, int minLength, bool extended)
+{
+	maxDegree = max(_maxDegree, 0);
+	minLength = max(minLength, 0);
+
+	const vector<Generator> &even_basis = cdga.GetGradedVectorSpace().GetEvenBasis();
+	const vector<Generator> &odd_basis = cdga.GetGradedVectorSpace().GetOddBasis();
+	int min_degree = cdga.GetGradedVectorSpace().GetMinimalDegree();
+	int maxLength = min_degree > 0 ? maxDegree / min_degree : 0;
+
+	// Coefficients of t^degree u^length in the series of /\X, and the total number of terms of the differentials of
+	// the factors of those words, indexed by [degree][length]
+	vector<vector<long long> > counts(maxDegree+1, vector<long long>(maxLength+1, 0));
+	vector<vector<long long> > terms(maxDegree+1, vector<long long>(maxLength+1, 0));
+	counts[0][0] = 1;
+
+	// Multiplying by 1/(1 - u t^d) updates the coefficients by increasing degree, so that each one already contains
+	// every power of the generator, while multiplying by (1 + u t^d) updates them by decreasing degree, so that each one
+	// only contains the generator at most once
+	for (int i=0; i<(int)even_basis.size(); i++) {
+		int deg = even_basis[i].degree;
+		long long k = differential.GetTermCount(even_basis[i].label);
+		for (int n=deg; n<=maxDegree; n++) {
+			for (int l=1; l<=maxLength; l++) {
+				counts[n][l] = AddCounts(counts[n][l], counts[n-deg][l-1]);
+				terms[n][l] = AddCounts(terms[n][l], AddCounts(terms[n-deg][l-1], MultiplyCounts(k, counts[n-deg][l-1])));
+			}
+		}
+	}
+	for (int i=0; i<(int)odd_basis.size(); i++) {
+		int deg = odd_basis[i].degree;
+		long long k = differential.GetTermCount(odd_basis[i].label);
+		for (int n=maxDegree; n>=deg; n--) {
+			for (int l=1; l<=maxLength; l++) {
+				counts[n][l] = AddCounts(counts[n][l], counts[n-deg][l-1]);
+				terms[n][l] = AddCounts(terms[n][l], AddCounts(terms[n-deg][l-1], MultiplyCounts(k, counts[n-deg][l-1])));
+			}
+		}
+	}
+
+	// /\^{>=minLength}X, and then the words x * t with x in /\^{+}X for each generator t of T
+	dimensions.assign(maxDegree+1, 0);
+	term_counts.assign(maxDegree+1, 0);
+	for (int n=0; n<=maxDegree; n++) {
+		for (int l=minLength; l<=maxLength; l++) {
+			dimensions[n] = AddCounts(dimensions[n], counts[n][l]);
+			term_counts[n] = AddCounts(term_counts[n], terms[n][l]);
+		}
+	}
+	if (extended) {
+		vector<vector<Generator> > T_degree_basis = cdga.GetExtensionSpace().GetDegreeIndexedBasis();
+		for (int deg=0; deg<(int)T_degree_basis.size(); deg++) {
+			vector<Generator>::const_iterator iter;
+			for (iter = T_degree_basis[deg].begin(); iter != T_degree_basis[deg].end(); iter++) {
+				long long k = differential.GetTermCount(iter->label);
+				for (int n=max(iter->degree, 0); n<=min(maxDegree, maxDegree+iter->degree); n++) {
+					for (int l=1; l<=maxLength; l++) {
+						long long c = counts[n-iter->degree][l];
+						dimensions[n] = AddCounts(dimensions[n], c);
+						term_counts[n] = AddCounts(term_counts[n], AddCounts(terms[n-iter->degree][l], MultiplyCounts(k, c)));
+					}
+				}
+			}
+		}
+	}
+}
+
+long long PoincareSeries::GetDimension(int degree) const
+{
+	if (degree < 0 || degree > maxDegree) {
+		return 0;
+	}
+	return dimensions[degree];
+}
+
+long long PoincareSeries::GetNonZeroBound(int degree) const
+{
+	if (degree < 0 || degree > maxDegree) {
+		return 0;
+	}
+	// A column has at most as many non-zero entries as the target has rows
+	return min(term_counts[degree], MultiplyCounts(dimensions[degree], GetDimension(degree+1)));
+}
+
+// Rough sizes of the objects of the computation, in bytes. An index of words is an open addressing table with between
+// two and four buckets per word, a cached differential is a list of a ListPool, and an NTL integer is a pointer which
+// owns a heap block unless it is zero.
+static const double INDEX_BYTES = 3 * sizeof(int);
+static const double CACHED_WORD_BYTES = INDEX_BYTES + sizeof(int) + sizeof(size_t);
+static const double ALLOCATION_BYTES = 16;
+static const double ZZ_BYTES = sizeof(void *);
+static const double ZZ_HEAP_BYTES = 32;
+
+void PlanRun(vector<DegreePlan> &plan, const FreeCGA &cdga, const Differential &differential, const OutputOptions &options, COMPUTE_MODE compute)
+{
+	int degree_start = options.homology_degree_start;
+	int degree_end = max(options.homology_degree_end, degree_start);
+	PoincareSeries series(cdga, differential, degree_end+1, options.category+1, true);
+
+	// A word stores one exponent per even generator and one bit per odd generator, of X and T alike, and only uses the
+	// heap when they don't fit in its inline storage (see Word)
+	const GradedVectorSpace &X = cdga.GetGradedVectorSpace();
+	const GradedVectorSpace &T = cdga.GetExtensionSpace();
+	size_t even_slots = X.GetEvenBasis().size() + T.GetEvenBasis().size();
+	size_t odd_slots = X.GetOddBasis().size() + T.GetOddBasis().size();
+	double word_bytes = sizeof(Word);
+	if (even_slots > 16)
+		word_bytes += ALLOCATION_BYTES + (double)((even_slots + 7) / 8 * 8);
+	if (odd_slots > 128)
+		word_bytes += ALLOCATION_BYTES + (double)((odd_slots + 63) / 64 * 8);
+	double entry_bytes = 2 * sizeof(long long); // An entry of a SparseMatrix
+	double cached_entry_bytes = sizeof(SparseVector::value_type); // An entry of a cached differential
+
+	// The differential of every word met since the beginning of the run stays in the cache
+	double cached_words = (double)series.GetDimension(degree_start-1);
+	double cached_entries = 0;
+
+	plan.clear();
+	for (int degree = degree_start-1; degree <= degree_end; degree++) {
+		DegreePlan p;
+		p.degree = degree;
+		p.dim_source = series.GetDimension(degree);
+		p.dim_target = series.GetDimension(degree+1);
+		p.nonzeros = series.GetNonZeroBound(degree);
+
+		double m = (double)p.dim_source;
+		double n = (double)p.dim_target;
+		double nonzeros = (double)p.nonzeros;
+		cached_words += n;
+		cached_entries += nonzeros;
+
+		double memory = cached_words * (word_bytes + CACHED_WORD_BYTES) + cached_entries * cached_entry_bytes;
+		// The starts of the columns of the matrix, and its entries unless they are written to a file as they are computed
+		// (see MatrixWriter)
+		memory += (m + 1) * sizeof(long long);
+		if (compute != COMPUTE_MATRICES) {
+			memory += nonzeros * entry_bytes;
+		}
+		if (compute == COMPUTE_MATRICES) {
+			// The source basis is read in chunks, and nothing else is computed
+			p.operations = nonzeros;
+		} else if (compute == COMPUTE_BETTI) {
+			// The source basis is read in chunks, and the reduced columns of the rank computation are stored sparsely
+			memory += nonzeros * sizeof(pair<long long, unsigned long>) + n * sizeof(long long);
+			// One elimination for each prime (see ComputeRank)
+			p.operations = 3 * m * n * min(m, n);
+		} else if (compute == COMPUTE_SPECTRAL) {
+			// Like COMPUTE_BETTI, but the columns waiting for a later page are kept as well, together with the word lengths
+			// of both bases and the order of the rows and columns
+			memory += 2 * nonzeros * sizeof(pair<long long, unsigned long>) + n * sizeof(long long);
+			memory += (m + n) * (sizeof(int) + 2 * sizeof(long long));
+			// One elimination for each prime (see ReduceFilteredMatrix)
+			p.operations = 2 * m * n * min(m, n);
+		} else {
+			// The bases of Z^n and Z^{n+1}, with an index of the latter
+			memory += m * word_bytes + n * (word_bytes + INDEX_BYTES);
+			// LLL works on the dense transpose D of the matrix and on the dense m x m transformation matrix U
+			memory += m * n * ZZ_BYTES + nonzeros * ZZ_HEAP_BYTES + m * m * (ZZ_BYTES + ZZ_HEAP_BYTES);
+			p.operations = m * m * n;
+		}
+		p.memory = memory;
+		plan.push_back(p);
+	}
+}
+
+double GetPeakMemory(const vector<DegreePlan> &plan)
+{
+	double peak = 0;
+	vector<DegreePlan>::const_iterator iter;
+	for (iter = plan.begin(); iter != plan.end(); iter++) {
+		peak = max(peak, iter->memory);
+	}
+	return peak;
+}
@@ -0,0 +1,57 @@
+#ifndef _PLANNER__H
+#define _PLANNER__H
+
+#include "cdga.h"
+
+// The Poincare series of /\X = Symm(X^even) (x) Ext(X^odd) is the product of 1/(1 - u t^|x|) over the even generators
+// x and of (1 + u t^|x|) over the odd generators x, where t counts the degree and u the word length. Expanding it up
+// to a given degree gives the dimension of every degree of /\^{>=n}X, and of /\^{>=n}X (+) (/\^{+}X (x) T by shifting
+// the series of /\^{+}X by the degree of each generator of T, without enumerating a single word.
+//
+// Along with the dimensions, the series counts the total number of terms of the differentials of the factors of the
+// words of each degree (d(x_1 ... x_k) has at most as many terms as d(x_1), ..., d(x_k) together), which bounds the
+// number of non-zero entries of the matrices of the differential.
+class PoincareSeries
+{
+public:
+	// The series describes the same bases as a BasisRanker with the same arguments (see ranking.h)
+	PoincareSeries(const FreeCGA &cdga, const Differential &differential, int maxDegree, int minLength, bool extended);
+
+	int GetMaxDegree() const { return maxDegree; }
+
+	// Return the dimension of the basis in a given degree (0 outside of 0, ..., maxDegree)
+	long long GetDimension(int degree) const;
+	// Return an upper bound for the number of non-zero entries of the matrix of the differential on a given degree
+	long long GetNonZeroBound(int degree) const;
+
+private:
+	int maxDegree;
+	vector<long long> dimensions;
+	vector<long long> term_counts;
+};
+
+// The estimated resources needed to compute the differential d_n : Z^n --> Z^{n+1} and to reduce it
+struct DegreePlan
+{
+	int degree;
+	long long dim_source; // dim Z^n
+	long long dim_target; // dim Z^{n+1}
+	long long nonzeros; // Upper bound for the number of non-zero entries of the matrix of d_n
+	double memory; // Estimated peak memory, in bytes
+	double operations; // Estimated number of arithmetic operations of the reduction
+};
+
+// Estimate the resources of every degree a run goes through, that is from the degree before the range of "options" up
+// to its end, if the run performs the computation "compute". The memory model follows that computation: the rolling
+// window of bases and the dense matrices of the lattice reduction for COMPUTE_EXTENSION, only the sparse matrix for
+// COMPUTE_BETTI and COMPUTE_SPECTRAL, only the starts of the columns for COMPUTE_MATRICES, and in every case the cache
+// of the differential, which grows over the whole run. The estimates ignore the growth of the coefficients and the fill-in of the
+// eliminations, and count the operations of a dense elimination.
+// COMPUTE_PIPELINE is estimated like COMPUTE_EXTENSION on the model as it is before the generators killing the homology
+// are added, so its estimates are lower bounds.
+void PlanRun(vector<DegreePlan> &plan, const FreeCGA &cdga, const Differential &differential, const OutputOptions &options, COMPUTE_MODE compute);
+
+// Return the largest estimated memory of the degrees of a plan, in bytes
+double GetPeakMemory(const vector<DegreePlan> &plan);
+
+#endif
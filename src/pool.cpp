@@ -0,0 +1,12 @@
+#include "pool.h"
+
+atomic<long long> AllocationCounters::array_allocations(0);
+atomic<long long> AllocationCounters::pool_allocations(0);
+atomic<long long> AllocationCounters::pool_releases(0);
+
+void AllocationCounters::Reset()
+{
+	array_allocations = 0;
+	pool_allocations = 0;
+	pool_releases = 0;
+}
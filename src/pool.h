@@ -0,0 +1,149 @@
+#ifndef _POOL__H
+#define _POOL__H
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <assert.h>
+
+using namespace std;
+
+// Counters of the heap allocations made by the containers below, so that the effect of pooling can be measured.
+// They are shared by all the threads of a Differential, hence atomic.
+struct AllocationCounters
+{
+	static atomic<long long> array_allocations; // SmallArrays which outgrew their inline storage
+	static atomic<long long> pool_allocations; // Reallocations of the storage of a ListPool
+	static atomic<long long> pool_releases; // ListPools whose storage was released
+
+	static void Reset();
+};
+
+// An array which stores up to N elements inline and only allocates memory beyond that, with the part of the interface
+// of vector<T> used in this program. Words keep their factors in SmallArrays, so a word over a few dozen generators
+// owns no heap memory at all, and creating, copying or destroying one costs no allocation.
+template<class T, int N>
+class SmallArray
+{
+public:
+	SmallArray() : data(inline_data), count(0), capacity(N) {}
+	SmallArray(const SmallArray &a) : data(inline_data), count(0), capacity(N) { *this = a; }
+	SmallArray(SmallArray &&a) noexcept : data(inline_data), count(a.count), capacity(N)
+	{
+		if (a.data == a.inline_data) {
+			copy(a.data, a.data + a.count, data);
+		} else {
+			// Take over the heap array
+			data = a.data;
+			capacity = a.capacity;
+			a.data = a.inline_data;
+			a.capacity = N;
+		}
+		a.count = 0;
+	}
+	~SmallArray() { if (data != inline_data) delete [] data; }
+
+	SmallArray &operator=(const SmallArray &a)
+	{
+		if (this != &a) {
+			reserve(a.count);
+			copy(a.data, a.data + a.count, data);
+			count = a.count;
+		}
+		return *this;
+	}
+
+	size_t size() const { return (size_t)count; }
+	bool empty() const { return count == 0; }
+	void clear() { count = 0; }
+	T &operator[](size_t i) { assert(i < (size_t)count); return data[i]; }
+	const T &operator[](size_t i) const { assert(i < (size_t)count); return data[i]; }
+	T &back() { assert(count > 0); return data[count-1]; }
+	const T &back() const { assert(count > 0); return data[count-1]; }
+	void pop_back() { assert(count > 0); count--; }
+	void push_back(const T &value) { reserve(count+1); data[count++] = value; }
+	T *begin() { return data; }
+	T *end() { return data + count; }
+	const T *begin() const { return data; }
+	const T *end() const { return data + count; }
+
+	void resize(size_t size, const T &value = T())
+	{
+		reserve(size);
+		for (int i=count; i<(int)size; i++) {
+			data[i] = value;
+		}
+		count = (int)size;
+	}
+
+	void reserve(size_t size)
+	{
+		if ((int)size <= capacity) {
+			return;
+		}
+		int new_capacity = max((int)size, 2*capacity);
+		T *new_data = new T[new_capacity];
+		copy(data, data + count, new_data);
+		if (data != inline_data) {
+			delete [] data;
+		}
+		data = new_data;
+		capacity = new_capacity;
+		AllocationCounters::array_allocations++;
+	}
+
+	bool operator==(const SmallArray &a) const { return count == a.count && equal(data, data + count, a.data); }
+	bool operator!=(const SmallArray &a) const { return !(*this == a); }
+	bool operator<(const SmallArray &a) const { return lexicographical_compare(data, data + count, a.data, a.data + a.count); }
+
+private:
+	T *data; // Either inline_data or an array on the heap
+	int count;
+	int capacity;
+	T inline_data[N];
+};
+
+// Many short lists stored back to back in a single array. The pool owns the memory of all of its lists and releases it
+// in one shot, instead of allocating and freeing each list on its own. Lists can only be appended, and are identified
+// by the order in which they were added.
+template<class T>
+class ListPool
+{
+public:
+	ListPool() : starts(1, 0) {}
+
+	// Append a copy of a list and return its index
+	int Add(const vector<T> &list)
+	{
+		size_t old_capacity = items.capacity() + starts.capacity();
+		items.insert(items.end(), list.begin(), list.end());
+		starts.push_back(items.size());
+		if (items.capacity() + starts.capacity() != old_capacity) {
+			AllocationCounters::pool_allocations++;
+		}
+		return (int)starts.size() - 2;
+	}
+
+	// The elements of list "index" are at positions Begin(index), ..., End(index)-1. The pointers are only valid until
+	// the next call to Add.
+	const T *Begin(int index) const { return items.data() + starts[index]; }
+	const T *End(int index) const { return items.data() + starts[index+1]; }
+	size_t GetSize(int index) const { return starts[index+1] - starts[index]; }
+	int GetCount() const { return (int)starts.size() - 1; }
+
+	// Remove every list and release the memory
+	void Clear()
+	{
+		if (items.capacity() > 0) {
+			AllocationCounters::pool_releases++;
+		}
+		vector<T>().swap(items);
+		vector<size_t>(1, 0).swap(starts);
+	}
+
+private:
+	vector<T> items;
+	vector<size_t> starts; // The list with index i starts at starts[i] and ends at starts[i+1]
+};
+
+#endif
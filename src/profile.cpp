@@ -0,0 +1,149 @@
+#include "profile.h"
+
+#ifdef CDGA_PROFILE
+
+#include <map>
+#include <vector>
+#include <mutex>
+#include <fstream>
+#include <iomanip>
+
+static const char *PHASE_NAMES[PHASE_COUNT] = {
+	"enumeration", "evaluation", "coordinates", "assembly", "kernel", "image", "quotient"
+};
+
+struct PhaseRecord
+{
+	PhaseRecord() : milliseconds(0), count(0) {}
+
+	double milliseconds;
+	long long count;
+};
+
+struct MatrixRecord
+{
+	long long rows;
+	long long cols;
+	long long nonzeros;
+	long bits; // The number of bits of the largest entry (in absolute value)
+};
+
+struct DegreeRecord
+{
+	DegreeRecord() : reduction_bits(0) {}
+
+	PhaseRecord phases[PHASE_COUNT];
+	vector<MatrixRecord> matrices;
+	long reduction_bits; // The number of bits of the largest coefficient of a kernel or an image
+};
+
+static mutex profile_lock;
+static chrono::steady_clock::time_point profile_start = chrono::steady_clock::now();
+static int current_degree = 0;
+static map<int, DegreeRecord> records;
+
+static long CountBits(unsigned long long value)
+{
+	long bits = 0;
+	for (; value != 0; value >>= 1) {
+		bits++;
+	}
+	return bits;
+}
+
+void Profiler::SetDegree(int degree)
+{
+	lock_guard<mutex> guard(profile_lock);
+	current_degree = degree;
+}
+
+void Profiler::AddTime(PROFILE_PHASE phase, double milliseconds)
+{
+	lock_guard<mutex> guard(profile_lock);
+	records[current_degree].phases[phase].milliseconds += milliseconds;
+}
+
+void Profiler::AddCount(PROFILE_PHASE phase, long long count)
+{
+	lock_guard<mutex> guard(profile_lock);
+	records[current_degree].phases[phase].count += count;
+}
+
+void Profiler::RecordMatrix(const SparseMatrix &m)
+{
+	MatrixRecord record;
+	record.rows = m.GetRows();
+	record.cols = m.GetCols();
+	record.nonzeros = m.GetNonZeros();
+	record.bits = 0;
+	for (long long k=0; k<record.nonzeros; k++) {
+		long long value = m.Value(k);
+		if (m.IsBig(k)) {
+			record.bits = max(record.bits, m.GetCoefficient(k).GetBitLength());
+		} else {
+			record.bits = max(record.bits, CountBits(value < 0 ? 0 - (unsigned long long)value : (unsigned long long)value));
+		}
+	}
+
+	lock_guard<mutex> guard(profile_lock);
+	records[current_degree].matrices.push_back(record);
+}
+
+void Profiler::RecordBits(long bits)
+{
+	lock_guard<mutex> guard(profile_lock);
+	DegreeRecord &record = records[current_degree];
+	record.reduction_bits = max(record.reduction_bits, bits);
+}
+
+bool Profiler::WriteReport(const string &filename)
+{
+	ofstream file(filename);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	lock_guard<mutex> guard(profile_lock);
+	double total = chrono::duration<double, milli>(chrono::steady_clock::now() - profile_start).count();
+	file << fixed << setprecision(3);
+	file << "{" << endl;
+	file << "  \"total_ms\": " << total << "," << endl;
+	file << "  \"degrees\": [";
+	map<int, DegreeRecord>::const_iterator iter;
+	for (iter = records.begin(); iter != records.end(); iter++) {
+		const DegreeRecord &record = iter->second;
+		file << (iter == records.begin() ? "" : ",") << endl;
+		file << "    {" << endl;
+		file << "      \"degree\": " << iter->first << "," << endl;
+		file << "      \"phases\": {";
+		for (int phase=0; phase<PHASE_COUNT; phase++) {
+			file << (phase == 0 ? "" : ",") << endl;
+			file << "        \"" << PHASE_NAMES[phase] << "\": { \"ms\": " << record.phases[phase].milliseconds
+				<< ", \"count\": " << record.phases[phase].count << " }";
+		}
+		file << endl << "      }," << endl;
+		file << "      \"matrices\": [";
+		vector<MatrixRecord>::const_iterator matrix;
+		for (matrix = record.matrices.begin(); matrix != record.matrices.end(); matrix++) {
+			file << (matrix == record.matrices.begin() ? "" : ",") << endl;
+			file << "        { \"rows\": " << matrix->rows << ", \"cols\": " << matrix->cols << ", \"nonzeros\": "
+				<< matrix->nonzeros << ", \"bits\": " << matrix->bits << " }";
+		}
+		file << (record.matrices.empty() ? "" : "\n      ") << "]," << endl;
+		file << "      \"reduction_bits\": " << record.reduction_bits << endl;
+		file << "    }";
+	}
+	file << (records.empty() ? "" : "\n  ") << "]" << endl;
+	file << "}" << endl;
+	return file.good();
+}
+
+void Profiler::Reset()
+{
+	lock_guard<mutex> guard(profile_lock);
+	profile_start = chrono::steady_clock::now();
+	current_degree = 0;
+	records.clear();
+}
+
+#endif
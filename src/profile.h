@@ -0,0 +1,105 @@
+#ifndef _PROFILE__H
+#define _PROFILE__H
+
+#include <string>
+#include <chrono>
+
+#include "sparse.h"
+
+using namespace std;
+
+// The phases of the computation of the homology in one degree, in the order in which they run
+enum PROFILE_PHASE
+{
+	PHASE_ENUMERATION, // Listing the words of a basis
+	PHASE_EVALUATION, // Computing the differential of a word (see Differential::GetCachedDifferential)
+	PHASE_COORDINATES, // Finding the index of each term of a differential in the target basis
+	PHASE_ASSEMBLY, // Building the matrix of a differential, including the two phases above (and the enumeration of a
+	// source basis which is read in chunks)
+	PHASE_KERNEL, // Reducing a matrix with LLL (or computing its rank modulo primes), which yields its kernel
+	PHASE_IMAGE, // Reading a basis of the image off the reduced matrix
+	PHASE_QUOTIENT, // Extending a basis of the boundaries to a basis of the cocycles
+	PHASE_COUNT
+};
+
+// Per-phase instrumentation of a run. The time spent in each phase and the number of items it processed (words,
+// columns, terms, rows...) are recorded for every degree, together with the dimensions, the number of non-zero entries
+// and the largest coefficient (in bits) of every matrix, and the largest coefficient of every reduction. The records
+// are written as a JSON report at the end of the run.
+// The instrumentation is only compiled when CDGA_PROFILE is defined. Otherwise every PROFILE_ macro below expands to
+// nothing, so the probes cost nothing in a normal build. The records are shared by the whole process and are
+// protected by a lock, so a profiled run should only compute one model at a time.
+#ifdef CDGA_PROFILE
+
+class Profiler
+{
+public:
+	// Work recorded from now on belongs to the differential d_n : X^n ---> X^{n+1} with n = "degree"
+	static void SetDegree(int degree);
+	static void AddTime(PROFILE_PHASE phase, double milliseconds);
+	static void AddCount(PROFILE_PHASE phase, long long count);
+	static void RecordMatrix(const SparseMatrix &m);
+	static void RecordBits(long bits);
+
+	// Write the records as JSON. Returns false if the file couldn't be written.
+	static bool WriteReport(const string &filename);
+	static void Reset();
+};
+
+// Measures the time between two calls to Start and Stop, and adds up the times of several such intervals
+class ProfileTimer
+{
+public:
+	ProfileTimer() : milliseconds(0) {}
+
+	void Start() { start = chrono::steady_clock::now(); }
+	void Stop() { milliseconds += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count(); }
+	double GetMilliseconds() const { return milliseconds; }
+
+private:
+	chrono::steady_clock::time_point start;
+	double milliseconds;
+};
+
+// Adds the time until the end of the enclosing scope to a phase
+class ProfileScope
+{
+public:
+	ProfileScope(PROFILE_PHASE _phase) : phase(_phase) { timer.Start(); }
+	~ProfileScope() { timer.Stop(); Profiler::AddTime(phase, timer.GetMilliseconds()); }
+
+private:
+	PROFILE_PHASE phase;
+	ProfileTimer timer;
+};
+
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_JOIN(profile_scope_, __LINE__)(phase)
+#define PROFILE_TIMER(timer) ProfileTimer timer
+#define PROFILE_START(timer) timer.Start()
+#define PROFILE_STOP(timer) timer.Stop()
+#define PROFILE_ADD_TIMER(phase, timer) Profiler::AddTime(phase, timer.GetMilliseconds())
+#define PROFILE_DEGREE(degree) Profiler::SetDegree(degree)
+#define PROFILE_COUNT(phase, count) Profiler::AddCount(phase, count)
+#define PROFILE_MATRIX(m) Profiler::RecordMatrix(m)
+#define PROFILE_BITS(bits) Profiler::RecordBits(bits)
+#define PROFILE_REPORT(filename) Profiler::WriteReport(filename)
+
+#else
+
+#define PROFILE_SCOPE(phase)
+#define PROFILE_TIMER(timer)
+#define PROFILE_START(timer) ((void)0)
+#define PROFILE_STOP(timer) ((void)0)
+#define PROFILE_ADD_TIMER(phase, timer) ((void)0)
+#define PROFILE_DEGREE(degree) ((void)0)
+#define PROFILE_COUNT(phase, count) ((void)0)
+#define PROFILE_MATRIX(m) ((void)0)
+#define PROFILE_BITS(bits) ((void)0)
+#define PROFILE_REPORT(filename) ((void)0)
+
+#endif
+
+#endif
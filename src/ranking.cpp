@@ -0,0 +1,353 @@
+#include "ranking.h"
+#include <algorithm>
+#include <stdexcept>
+#include <assert.h>
+
+using namespace std;
+
+BasisRanker::BasisRanker(const FreeCGA &cdga, int _maxDegree, int _minLength, bool _extended)
+{
+	maxDegree = _maxDegree;
+	minLength = max(_minLength, 0); // A negative minimal length has the same effect as 0
+	extended = _extended;
+
+	even_basis = cdga.GetGradedVectorSpace().GetEvenBasis();
+	odd_basis = cdga.GetGradedVectorSpace().GetOddBasis();
+	if (extended) {
+		T_basis = cdga.GetExtensionSpace().GetBasis();
+	}
+
+	// Map generators back to their index in X^even, X^odd and T
+	registry = &cdga.GetGeneratorRegistry();
+	const GeneratorRegistry &registry = *this->registry;
+	even_index.assign(registry.GetSize(), -1);
+	odd_index.assign(registry.GetSize(), -1);
+	T_index.assign(registry.GetSize(), -1);
+	int minGeneratorDegree = cdga.GetGradedVectorSpace().GetMinimalDegree();
+	for (int i=0; i<(int)even_basis.size(); i++) {
+		even_basis[i].id = registry.Find(even_basis[i].label);
+		even_index[registry.GetSlot(even_basis[i].id)] = i;
+	}
+	for (int i=0; i<(int)odd_basis.size(); i++) {
+		odd_basis[i].id = registry.Find(odd_basis[i].label);
+		odd_index[registry.GetSlot(odd_basis[i].id)] = i;
+	}
+	for (int i=0; i<(int)T_basis.size(); i++) {
+		T_basis[i].id = registry.Find(T_basis[i].label);
+		T_index[T_basis[i].id] = i;
+	}
+
+	// Words of degree at most maxDegree have length at most maxLength
+	int maxLength = minGeneratorDegree > 0 ? maxDegree / minGeneratorDegree : 0;
+	int dim_even = (int)even_basis.size();
+	int dim_odd = (int)odd_basis.size();
+
+	// Fill the tables of CountSymmetric and CountExterior, starting from the last generator
+	symmetric_counts.assign(dim_even+1, vector<vector<long long> >(maxLength+1, vector<long long>(maxDegree+1, 0)));
+	symmetric_counts[dim_even][0][0] = 1;
+	for (int i=dim_even-1; i>=0; i--) {
+		int deg = even_basis[i].degree;
+		for (int k=0; k<=maxLength; k++) {
+			for (int e=0; e<=maxDegree; e++) {
+				// Either X^even[i] is not a factor, or it is a factor and we may still use it again
+				long long count = symmetric_counts[i+1][k][e];
+				if (k >= 1 && e >= deg)
+					count += symmetric_counts[i][k-1][e-deg];
+				symmetric_counts[i][k][e] = count;
+			}
+		}
+	}
+
+	int maxOddLength = min(maxLength, dim_odd);
+	exterior_counts.assign(dim_odd+1, vector<vector<long long> >(maxOddLength+1, vector<long long>(maxDegree+1, 0)));
+	exterior_counts[dim_odd][0][0] = 1;
+	for (int i=dim_odd-1; i>=0; i--) {
+		int deg = odd_basis[i].degree;
+		for (int k=0; k<=maxOddLength; k++) {
+			for (int e=0; e<=maxDegree; e++) {
+				long long count = exterior_counts[i+1][k][e];
+				if (k >= 1 && e >= deg)
+					count += exterior_counts[i+1][k-1][e-deg];
+				exterior_counts[i][k][e] = count;
+			}
+		}
+	}
+
+	// Finally, count the words preceding each block of words with a given length and number of odd factors
+	block_offsets.assign(maxDegree+1, vector<vector<long long> >(maxLength+2, vector<long long>(maxOddLength+2, 0)));
+	for (int deg=0; deg<=maxDegree; deg++) {
+		long long offset = 0;
+		for (int len=0; len<=maxLength; len++) {
+			for (int m=0; m<=min(len, maxOddLength); m++) {
+				block_offsets[deg][len][m] = offset;
+				offset += CountBlock(len-m, m, deg);
+			}
+			// The entry past the last block of this length is where the next length starts
+			block_offsets[deg][len][min(len, maxOddLength)+1] = offset;
+		}
+		block_offsets[deg][maxLength+1][0] = offset;
+	}
+}
+
+int BasisRanker::GetMaxDegree() const
+{
+	return maxDegree;
+}
+
+long long BasisRanker::CountSymmetric(int i, int length, int degree) const
+{
+	if (length < 0 || length >= (int)symmetric_counts[i].size() || degree < 0 || degree > maxDegree)
+		return 0;
+	return symmetric_counts[i][length][degree];
+}
+
+long long BasisRanker::CountExterior(int i, int length, int degree) const
+{
+	if (length < 0 || length >= (int)exterior_counts[i].size() || degree < 0 || degree > maxDegree)
+		return 0;
+	return exterior_counts[i][length][degree];
+}
+
+long long BasisRanker::CountBlock(int even_length, int odd_length, int degree) const
+{
+	long long count = 0;
+	for (int e=0; e<=degree; e++) {
+		long long ext = CountExterior(0, odd_length, e);
+		if (ext != 0)
+			count += ext * CountSymmetric(0, even_length, degree-e);
+	}
+	return count;
+}
+
+long long BasisRanker::CountWords(int minLength, int degree) const
+{
+	if (degree < 0 || degree > maxDegree)
+		return 0;
+	int maxLength = (int)block_offsets[degree].size() - 2;
+	if (minLength > maxLength)
+		return 0;
+	return block_offsets[degree][maxLength+1][0] - block_offsets[degree][minLength][0];
+}
+
+long long BasisRanker::GetDimension(int degree) const
+{
+	if (degree < 0 || degree > maxDegree) {
+		throw logic_error("The degree requested is out of the range of the BasisRanker.");
+	}
+	long long dim = CountWords(minLength, degree);
+	for (int t=0; t<(int)T_basis.size(); t++) {
+		dim += CountWords(1, degree - T_basis[t].degree);
+	}
+	return dim;
+}
+
+long long BasisRanker::RankWord(const FactorList &even_factors, const FactorList &odd_factors, int minLength, int degree) const
+{
+	int n = (int)even_factors.size();
+	int m = (int)odd_factors.size();
+	if (n+m < minLength) {
+		return -1;
+	}
+
+	// Skip the words of smaller length, or of the same length and fewer odd factors
+	long long rank = block_offsets[degree][n+m][m] - block_offsets[degree][minLength][0];
+
+	// Skip the words whose odd factors come first in the lexicographical order. For each such choice of odd factors,
+	// every possible choice of even factors in the remaining degree gives one word.
+	int consumed = 0;
+	int lower_bound = 0;
+	for (int j=0; j<m; j++) {
+		for (int v=lower_bound; v<odd_factors[j]; v++) {
+			int remaining = degree - consumed - odd_basis[v].degree;
+			for (int e=0; e<=remaining; e++) {
+				long long ext = CountExterior(v+1, m-j-1, e);
+				if (ext != 0)
+					rank += ext * CountSymmetric(0, n, remaining-e);
+			}
+		}
+		consumed += odd_basis[odd_factors[j]].degree;
+		lower_bound = odd_factors[j] + 1;
+	}
+
+	// Skip the words with the same odd factors but whose even factors come first in the lexicographical order
+	lower_bound = 0;
+	for (int j=0; j<n; j++) {
+		for (int v=lower_bound; v<even_factors[j]; v++) {
+			rank += CountSymmetric(v, n-j-1, degree - consumed - even_basis[v].degree);
+		}
+		consumed += even_basis[even_factors[j]].degree;
+		lower_bound = even_factors[j];
+	}
+
+	return rank;
+}
+
+long long BasisRanker::Rank(const Word &word) const
+{
+	int degree = word.GetDegree();
+	if (degree > maxDegree) {
+		throw logic_error("The degree of the word is out of the range of the BasisRanker.");
+	}
+
+	if (word.IsUnit()) {
+		return (degree == 0 && minLength == 0) ? 0 : -1;
+	}
+
+	// Split the word into its factors in X^even, X^odd and T
+	assert(word.GetGeneratorRegistry() == registry);
+	FactorList even_factors, odd_factors;
+	int t_index = -1;
+	for (int slot=0; slot<word.GetEvenSlotCount(); slot++) {
+		int power = word.GetEvenExponent(slot);
+		if (power == 0)
+			continue;
+		if (even_index[slot] >= 0) {
+			for (int i=0; i<power; i++) {
+				even_factors.push_back(even_index[slot]);
+			}
+		} else {
+			int id = registry->GetEvenGenerator(slot);
+			if (power > 1 || t_index >= 0 || T_index[id] < 0)
+				return -1;
+			t_index = T_index[id];
+		}
+	}
+	for (int slot=0; slot<word.GetOddSlotCount(); slot++) {
+		if (!word.HasOddGenerator(slot))
+			continue;
+		if (odd_index[slot] >= 0) {
+			odd_factors.push_back(odd_index[slot]);
+		} else {
+			int id = registry->GetOddGenerator(slot);
+			if (t_index >= 0 || T_index[id] < 0)
+				return -1;
+			t_index = T_index[id];
+		}
+	}
+	sort(even_factors.begin(), even_factors.end());
+	sort(odd_factors.begin(), odd_factors.end());
+
+	if (t_index < 0) {
+		return RankWord(even_factors, odd_factors, minLength, degree);
+	}
+
+	// The word is x * t, so skip /\^{>=n}X and the words x * t' for t' coming before t
+	long long rank = RankWord(even_factors, odd_factors, 1, degree - T_basis[t_index].degree);
+	if (rank < 0) {
+		return -1;
+	}
+	rank += CountWords(minLength, degree);
+	for (int t=0; t<t_index; t++) {
+		rank += CountWords(1, degree - T_basis[t].degree);
+	}
+	return rank;
+}
+
+void BasisRanker::UnrankWord(FactorList &even_factors, FactorList &odd_factors, int minLength, int degree, long long index) const
+{
+	even_factors.clear();
+	odd_factors.clear();
+
+	// First find the block of words with the right length and number of odd factors
+	index += block_offsets[degree][minLength][0];
+	int len = minLength;
+	while (block_offsets[degree][len+1][0] <= index) {
+		len++;
+	}
+	int m = 0;
+	while (block_offsets[degree][len][m+1] <= index) {
+		m++;
+	}
+	index -= block_offsets[degree][len][m];
+	int n = len - m;
+
+	// Next, choose the odd factors one at a time, skipping over the words that start with a smaller factor
+	int consumed = 0;
+	int v = 0;
+	for (int j=0; j<m; j++) {
+		for ( ; ; v++) {
+			int remaining = degree - consumed - odd_basis[v].degree;
+			long long count = 0;
+			for (int e=0; e<=remaining; e++) {
+				long long ext = CountExterior(v+1, m-j-1, e);
+				if (ext != 0)
+					count += ext * CountSymmetric(0, n, remaining-e);
+			}
+			if (index < count)
+				break;
+			index -= count;
+		}
+		odd_factors.push_back(v);
+		consumed += odd_basis[v].degree;
+		v++;
+	}
+
+	// Finally, choose the even factors in the same way
+	v = 0;
+	for (int j=0; j<n; j++) {
+		for ( ; ; v++) {
+			long long count = CountSymmetric(v, n-j-1, degree - consumed - even_basis[v].degree);
+			if (index < count)
+				break;
+			index -= count;
+		}
+		even_factors.push_back(v);
+		consumed += even_basis[v].degree;
+	}
+}
+
+void BasisRanker::CreateWord(Word &word, const FactorList &even_factors, const FactorList &odd_factors, int t_index) const
+{
+	word.Clear();
+	if (even_factors.empty() && odd_factors.empty() && t_index < 0) {
+		word.SetToUnit(true);
+		return;
+	}
+	for (int i=0; i<(int)even_factors.size(); i++) {
+		word.AddPowerOfGenerator(even_basis[even_factors[i]], 1);
+	}
+	for (int i=0; i<(int)odd_factors.size(); i++) {
+		word.AddPowerOfGenerator(odd_basis[odd_factors[i]], 1);
+	}
+	if (t_index >= 0) {
+		word.AddPowerOfGenerator(T_basis[t_index], 1);
+	}
+}
+
+void BasisRanker::Unrank(Word &word, int degree, long long index) const
+{
+	if (index < 0 || index >= GetDimension(degree)) {
+		throw logic_error("The index of the word to unrank is out of range.");
+	}
+
+	FactorList even_factors, odd_factors;
+	long long count = CountWords(minLength, degree);
+	if (index < count) {
+		UnrankWord(even_factors, odd_factors, minLength, degree, index);
+		CreateWord(word, even_factors, odd_factors, -1);
+		return;
+	}
+	index -= count;
+
+	for (int t=0; t<(int)T_basis.size(); t++) {
+		int deg = degree - T_basis[t].degree;
+		count = CountWords(1, deg);
+		if (index < count) {
+			UnrankWord(even_factors, odd_factors, 1, deg, index);
+			CreateWord(word, even_factors, odd_factors, t);
+			return;
+		}
+		index -= count;
+	}
+	assert(0);
+}
+
+void BasisRanker::GetBasis(OrderedBasis &basis, int degree) const
+{
+	long long dim = GetDimension(degree);
+	basis.clear();
+	basis.resize((size_t)dim);
+	for (long long i=0; i<dim; i++) {
+		Unrank(basis[(size_t)i], degree, i);
+	}
+}
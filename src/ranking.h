@@ -0,0 +1,84 @@
+#ifndef _RANKING__H
+#define _RANKING__H
+
+#include "cdga.h"
+
+// The ordered bases returned by FreeCGA::GetDegreeIndexedBasis and FreeCGA::GetDegreeIndexedBasisExtended follow a
+// fixed combinatorial order. In a given degree, words of /\X are listed:
+// (1) by increasing word length,
+// (2) then by increasing number of odd factors,
+// (3) then by the lexicographical order of their odd factors (as indices into X^odd, see GetOrderedBasisExteriorAlgebra),
+// (4) then by the lexicographical order of their even factors (as indices into X^even, see GetOrderedBasisSymmetricAlgebra).
+// In /\^{>=n}X (+) (/\^{+}X (x) T, the words of /\^{>=n}X come first, followed by the words x * t, grouped by the
+// generator t of T (in the order in which the generators were added to T, see FreeCGA::ExtendBasisInDegree) and then
+// ordered as words x of /\^{+}X.
+//
+// A BasisRanker computes the position ("rank") of a word in that order and the word at a given position ("unrank")
+// with the combinatorial number system, weighted by the degrees of the generators. This allows working with a basis
+// without materializing the vector<OrderedBasis>.
+class BasisRanker
+{
+public:
+	// The ranker describes the basis of /\^{>=minLength}X, or of /\^{>=minLength}X (+) (/\^{+}X (x) T if "extended"
+	// is true, in every degree from 0 to "maxDegree".
+	BasisRanker(const FreeCGA &cdga, int maxDegree, int minLength, bool extended);
+
+	int GetMaxDegree() const;
+
+	// Return the dimension of the basis in a given degree
+	long long GetDimension(int degree) const;
+
+	// Return the position of "word" in the basis of its degree, or -1 if the word is not part of the basis
+	long long Rank(const Word &word) const;
+
+	// Set "word" to the word at position "index" in the basis in degree "degree"
+	void Unrank(Word &word, int degree, long long index) const;
+
+	// Store the whole basis in degree "degree" into "basis", in order
+	void GetBasis(OrderedBasis &basis, int degree) const;
+
+private:
+	// Number of multisets of "length" even generators taken among X^even[i], X^even[i+1], ... with total degree "degree"
+	long long CountSymmetric(int i, int length, int degree) const;
+	// Number of sets of "length" odd generators taken among X^odd[i], X^odd[i+1], ... with total degree "degree"
+	long long CountExterior(int i, int length, int degree) const;
+	// Number of words of /\X with exactly "odd_length" odd factors and "even_length" even factors in degree "degree"
+	long long CountBlock(int even_length, int odd_length, int degree) const;
+	// Dimension of /\^{>=minLength}X in degree "degree"
+	long long CountWords(int minLength, int degree) const;
+
+	// Indices of the factors of a word into X^even or X^odd. Ranking a word is done for every entry of a matrix, so
+	// the indices are stored inline (see SmallArray in pool.h) and need no allocation.
+	typedef SmallArray<int, 32> FactorList;
+
+	// Rank and unrank restricted to the words of /\^{>=minLength}X
+	long long RankWord(const FactorList &even_factors, const FactorList &odd_factors, int minLength, int degree) const;
+	void UnrankWord(FactorList &even_factors, FactorList &odd_factors, int minLength, int degree, long long index) const;
+
+	// Turn a list of indices into X^even, X^odd and T into a word
+	void CreateWord(Word &word, const FactorList &even_factors, const FactorList &odd_factors, int t_index) const;
+
+	int maxDegree;
+	int minLength;
+	bool extended;
+
+	vector<Generator> even_basis; // X^even
+	vector<Generator> odd_basis; // X^odd
+	vector<Generator> T_basis; // T, in the order used by the extended basis
+	const GeneratorRegistry *registry; // The registry of the model
+
+	// Map the slots of the GeneratorRegistry to indices into X^even, X^odd (or -1 if the generator is not in X)
+	vector<int> even_index;
+	vector<int> odd_index;
+	// Map generator IDs to indices into T_basis (or -1 if the generator is not in T)
+	vector<int> T_index;
+
+	// Tables of CountSymmetric and CountExterior, indexed by [i][length][degree]
+	vector<vector<vector<long long> > > symmetric_counts;
+	vector<vector<vector<long long> > > exterior_counts;
+	// Number of words of /\X in a given degree preceding the words of a given length and number of odd factors,
+	// indexed by [degree][length][number of odd factors]
+	vector<vector<vector<long long> > > block_offsets;
+};
+
+#endif
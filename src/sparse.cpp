@@ -0,0 +1,187 @@
+#include "sparse.h"
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#include <assert.h>
+
+using namespace std;
+
+void NormalizeSparseVector(SparseVector &v)
+{
+	if (!TryNormalizeSparseVector(v)) {
+		throw logic_error("A coefficient of a sparse vector doesn't fit in 64 bits.");
+	}
+}
+
+bool TryNormalizeSparseVector(SparseVector &v)
+{
+	sort(v.begin(), v.end());
+
+	// Combine the coefficients of repeated indices and drop zero coefficients
+	size_t size = 0;
+	for (size_t i=0; i<v.size(); ) {
+		long long index = v[i].first;
+		long long coeff = 0;
+		for ( ; i<v.size() && v[i].first == index; i++) {
+			long long c = v[i].second;
+			if (c < -LLONG_MAX || (coeff >= 0 ? c > LLONG_MAX - coeff : c < -LLONG_MAX - coeff)) {
+				return false;
+			}
+			coeff += c;
+		}
+		if (coeff != 0) {
+			v[size++] = make_pair(index, coeff);
+		}
+	}
+	v.resize(size);
+	return true;
+}
+
+const long long SparseMatrix::BIG_VALUE;
+
+SparseMatrix::SparseMatrix()
+{
+	SetDims(0, 0);
+}
+
+SparseMatrix::SparseMatrix(long long _rows, long long _cols)
+{
+	SetDims(_rows, _cols);
+}
+
+void SparseMatrix::SetDims(long long _rows, long long _cols)
+{
+	rows = _rows;
+	cols = _cols;
+	col_starts.assign(cols+1, 0);
+	row_indices.clear();
+	values.clear();
+	big_values.clear();
+}
+
+void SparseMatrix::Reset(long long _rows)
+{
+	SetDims(_rows, 0);
+}
+
+void SparseMatrix::AppendColumn(const SparseVector &column)
+{
+	SparseVector::const_iterator iter;
+	for (iter = column.begin(); iter != column.end(); iter++) {
+		assert(iter->first >= 0 && iter->first < rows && iter->second != 0);
+		row_indices.push_back(iter->first);
+		values.push_back(iter->second);
+	}
+	col_starts.push_back((long long)values.size());
+	cols++;
+}
+
+void SparseMatrix::AppendColumn(const CoefficientVector &column)
+{
+	CoefficientVector::const_iterator iter;
+	for (iter = column.begin(); iter != column.end(); iter++) {
+		assert(iter->first >= 0 && iter->first < rows && !iter->second.IsZero());
+		row_indices.push_back(iter->first);
+		if (iter->second.IsSmall()) {
+			values.push_back(iter->second.GetSmall());
+		} else {
+			big_values[(long long)values.size()] = iter->second;
+			values.push_back(BIG_VALUE);
+		}
+	}
+	col_starts.push_back((long long)values.size());
+	cols++;
+}
+
+void SparseMatrix::AppendColumns(const SparseMatrix &m)
+{
+	assert(m.rows == rows);
+	long long offset = (long long)values.size();
+	row_indices.insert(row_indices.end(), m.row_indices.begin(), m.row_indices.end());
+	values.insert(values.end(), m.values.begin(), m.values.end());
+	map<long long, Coefficient>::const_iterator big;
+	for (big = m.big_values.begin(); big != m.big_values.end(); big++) {
+		big_values[offset + big->first] = big->second;
+	}
+	for (long long j=0; j<m.cols; j++) {
+		col_starts.push_back(offset + m.col_starts[j+1]);
+	}
+	cols += m.cols;
+}
+
+const Coefficient &SparseMatrix::GetBigValue(long long k) const
+{
+	map<long long, Coefficient>::const_iterator iter = big_values.find(k);
+	assert(iter != big_values.end());
+	return iter->second;
+}
+
+Coefficient SparseMatrix::GetEntry(long long i, long long j) const
+{
+	vector<long long>::const_iterator begin = row_indices.begin() + col_starts[j];
+	vector<long long>::const_iterator end = row_indices.begin() + col_starts[j+1];
+	vector<long long>::const_iterator iter = lower_bound(begin, end, i);
+	if (iter == end || *iter != i) {
+		return Coefficient();
+	}
+	return GetCoefficient(iter - row_indices.begin());
+}
+
+void SparseMatrix::Transpose(SparseMatrix &result) const
+{
+	// Count the entries in each row, which become the columns of the result
+	vector<long long> starts(rows+1, 0);
+	for (long long k=0; k<GetNonZeros(); k++) {
+		starts[row_indices[k]+1]++;
+	}
+	for (long long i=0; i<rows; i++) {
+		starts[i+1] += starts[i];
+	}
+
+	vector<long long> indices(values.size());
+	vector<long long> transposed_values(values.size());
+	vector<long long> next(starts.begin(), starts.end()-1);
+	map<long long, Coefficient> transposed_big_values;
+	for (long long j=0; j<cols; j++) {
+		for (long long k=col_starts[j]; k<col_starts[j+1]; k++) {
+			long long pos = next[row_indices[k]]++;
+			indices[pos] = j;
+			transposed_values[pos] = values[k];
+			if (values[k] == BIG_VALUE) {
+				transposed_big_values[pos] = GetBigValue(k);
+			}
+		}
+	}
+
+	result.rows = cols;
+	result.cols = rows;
+	result.col_starts.swap(starts);
+	result.row_indices.swap(indices);
+	result.values.swap(transposed_values);
+	result.big_values.swap(transposed_big_values);
+}
+
+void SparseMatrix::Clear()
+{
+	// Swap with empty vectors to really release the memory
+	vector<long long>().swap(row_indices);
+	vector<long long>().swap(values);
+	vector<long long>().swap(col_starts);
+	SetDims(0, 0);
+}
+
+ostream& operator<<(ostream &stream, const SparseMatrix &m)
+{
+	stream << "[";
+	for (long long i=0; i<m.GetRows(); i++) {
+		stream << "[";
+		for (long long j=0; j<m.GetCols(); j++) {
+			if (j > 0)
+				stream << " ";
+			stream << m.GetEntry(i, j);
+		}
+		stream << "]" << endl;
+	}
+	stream << "]";
+	return stream;
+}
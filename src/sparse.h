@@ -0,0 +1,97 @@
+#ifndef _SPARSE__H
+#define _SPARSE__H
+
+#include <vector>
+#include <map>
+#include <utility>
+#include <iostream>
+
+#include "coefficient.h"
+
+using namespace std;
+
+// A sparse vector is a list of (index, coefficient) pairs. The coefficients are 64-bit, which costs no memory since
+// an index is 64-bit as well (see Coefficient in coefficient.h for arbitrarily large coefficients).
+typedef vector<pair<long long, long long> > SparseVector;
+
+// Sort the entries of a sparse vector by index, combine repeated indices and remove zero coefficients.
+// Throws a logic_error if a coefficient doesn't fit in [-LLONG_MAX, LLONG_MAX].
+void NormalizeSparseVector(SparseVector &v);
+// Same as above, but returns false instead of throwing if a coefficient doesn't fit. The vector is then left unspecified.
+bool TryNormalizeSparseVector(SparseVector &v);
+
+// A sparse integer matrix, stored column by column (compressed sparse column format, or CSC) with 64-bit indices.
+// The matrix of a differential has one column per element of the source basis and each column only has the few
+// non-zero entries produced by Leibniz' rule, so it is built one column at a time with AppendColumn.
+// Note: The transpose of a matrix stored in CSC format is the same matrix stored by rows (CSR format).
+// The few entries which don't fit in 64 bits (they come from differentials with huge coefficients, see Differential in
+// cdga.h) are stored on the side, and their value in the column is BIG_VALUE, so the other entries cost nothing more.
+class SparseMatrix
+{
+public:
+	SparseMatrix();
+	SparseMatrix(long long _rows, long long _cols);
+
+	// Make this the zero matrix of size rows x cols
+	void SetDims(long long _rows, long long _cols);
+	// Make this a matrix with "_rows" rows and no columns yet. Columns can then be added with AppendColumn.
+	void Reset(long long _rows);
+	// Append a column to the right of the matrix. The vector must be normalized (see NormalizeSparseVector).
+	void AppendColumn(const SparseVector &column);
+	// Same as above, for a column whose coefficients may not fit in 64 bits (see NormalizeCoefficientVector)
+	void AppendColumn(const CoefficientVector &column);
+	// Append the columns of "m", which must have the same number of rows, to the right of the matrix
+	void AppendColumns(const SparseMatrix &m);
+
+	long long GetRows() const { return rows; }
+	long long GetCols() const { return cols; }
+	long long GetNonZeros() const { return (long long)values.size(); }
+	bool IsZero() const { return values.empty(); }
+	// Return true if an entry of the matrix doesn't fit in 64 bits
+	bool HasBigValues() const { return !big_values.empty(); }
+
+	// The entries of column j are stored at positions ColumnBegin(j), ..., ColumnEnd(j)-1, by increasing row index
+	long long ColumnBegin(long long j) const { return col_starts[j]; }
+	long long ColumnEnd(long long j) const { return col_starts[j+1]; }
+	long long RowIndex(long long k) const { return row_indices[k]; }
+	// The value of the entry at position k, or BIG_VALUE if it doesn't fit in 64 bits
+	long long Value(long long k) const { return values[k]; }
+	bool IsBig(long long k) const { return values[k] == BIG_VALUE; }
+	// The value of the entry at position k, whatever its size
+	Coefficient GetCoefficient(long long k) const { return values[k] != BIG_VALUE ? Coefficient(values[k]) : GetBigValue(k); }
+	// The residue modulo p of the entry at position k, in [0, p)
+	unsigned long GetResidue(long long k, unsigned long p) const
+	{
+		if (values[k] == BIG_VALUE)
+			return GetBigValue(k).GetResidue(p);
+		long long r = values[k] % (long long)p;
+		return (unsigned long)(r < 0 ? r + (long long)p : r);
+	}
+
+	// Return the entry in row i and column j (this requires a binary search in column j)
+	Coefficient GetEntry(long long i, long long j) const;
+
+	// Store the transpose of this matrix into "result"
+	void Transpose(SparseMatrix &result) const;
+
+	// Free the memory used by the matrix
+	void Clear();
+
+	// The value of an entry which doesn't fit in 64 bits (no coefficient stored in a machine word has this value)
+	static const long long BIG_VALUE = -Coefficient::LARGEST - 1;
+
+private:
+	const Coefficient &GetBigValue(long long k) const;
+
+	long long rows;
+	long long cols;
+	vector<long long> col_starts; // Has cols+1 entries, the last one is the number of non-zero entries
+	vector<long long> row_indices;
+	vector<long long> values;
+	map<long long, Coefficient> big_values; // The entries which don't fit in 64 bits, by position
+};
+
+// Output the matrix as a dense array, one row per line
+ostream& operator<<(ostream &stream, const SparseMatrix &m);
+
+#endif
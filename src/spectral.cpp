@@ -0,0 +1,105 @@
+#include "spectral.h"
+#include "modular.h"
+#include "ranking.h"
+#include "enumeration.h"
+#include "profile.h"
+
+#include <algorithm>
+
+// Store the word length of each word of the basis in a degree, in the order of the basis
+static void GetWordLengths(const FreeCGA &cdga, int degree, int minLength, vector<int> &lengths)
+{
+	lengths.clear();
+	BasisIterator words(cdga, degree, minLength, true);
+	Word word;
+	while (words.Next(word)) {
+		lengths.push_back(word.GetLength());
+	}
+}
+
+void LengthSpectralSequence::Compute(const FreeCGA &cdga, Differential &diff, int _degree_start, int degree_end, int category)
+{
+	degree_start = _degree_start;
+	degrees.assign(degree_end - degree_start + 1, DegreePages());
+	BasisRanker ranker(cdga, degree_end+1, category+1, true);
+	SparseMatrix diff_matrix;
+	vector<long long> pairs;
+
+	// The lengths of the words of X^n and X^{n+1}, for the differential d_n
+	vector<int> source_lengths, target_lengths;
+	GetWordLengths(cdga, degree_start-1, category+1, target_lengths);
+	for (int degree = degree_start-1; degree <= degree_end; degree++) {
+		PROFILE_DEGREE(degree);
+		source_lengths.swap(target_lengths);
+		GetWordLengths(cdga, degree+1, category+1, target_lengths);
+		if (degree+1 <= degree_end && !target_lengths.empty()) {
+			DegreePages &pages = degrees[degree+1 - degree_start];
+			pages.min_length = *min_element(target_lengths.begin(), target_lengths.end());
+			int max_length = *max_element(target_lengths.begin(), target_lengths.end());
+			pages.words.assign(max_length - pages.min_length + 1, 0);
+			pages.paired.resize(pages.words.size());
+			vector<int>::const_iterator iter;
+			for (iter = target_lengths.begin(); iter != target_lengths.end(); iter++) {
+				pages.words[*iter - pages.min_length]++;
+			}
+		}
+		if (source_lengths.empty() || target_lengths.empty()) {
+			continue;
+		}
+
+		BasisIterator source(cdga, degree, category+1, true);
+		diff.ComputeDifferentialMatrix(diff_matrix, source, ranker);
+		ReduceFilteredMatrix(diff_matrix, source_lengths, target_lengths, pairs);
+		diff_matrix.Clear();
+
+		// A pair kills a word of X^n and a word of X^{n+1}
+		for (size_t j=0; j<pairs.size(); j++) {
+			if (pairs[j] < 0) {
+				continue;
+			}
+			int source_length = source_lengths[j];
+			int target_length = target_lengths[(size_t)pairs[j]];
+			if (degree >= degree_start) {
+				AddPair(degree, source_length, target_length - source_length);
+			}
+			if (degree+1 <= degree_end) {
+				AddPair(degree+1, target_length, target_length - source_length);
+			}
+		}
+	}
+}
+
+void LengthSpectralSequence::AddPair(int degree, int length, int distance)
+{
+	DegreePages &pages = degrees[degree - degree_start];
+	vector<long long> &paired = pages.paired[length - pages.min_length];
+	if ((int)paired.size() <= distance) {
+		paired.resize(distance+1, 0);
+	}
+	paired[distance]++;
+	// The class is still on the page E_distance, and is gone from the next one on
+	pages.last_page = max(pages.last_page, distance+1);
+}
+
+long long LengthSpectralSequence::GetDimension(int degree, int page, int length) const
+{
+	const DegreePages &pages = GetDegree(degree);
+	int p = length - pages.min_length;
+	if (p < 0 || p >= (int)pages.words.size()) {
+		return 0;
+	}
+	long long dim = pages.words[p];
+	for (int r=0; r<page && r<(int)pages.paired[p].size(); r++) {
+		dim -= pages.paired[p][r];
+	}
+	return dim;
+}
+
+long long LengthSpectralSequence::GetHomologyDimension(int degree) const
+{
+	long long dim = 0;
+	for (int length=GetMinLength(degree); length<=GetMaxLength(degree); length++) {
+		dim += GetDimension(degree, GetLastPage(degree), length);
+	}
+	return dim;
+}
@@ -0,0 +1,65 @@
+#ifndef _SPECTRAL__H
+#define _SPECTRAL__H
+
+#include <vector>
+
+#include "cdga.h"
+
+using namespace std;
+
+// The differential of a Sullivan model never shortens a word: it raises the length of a word of /\X by at least one in a
+// minimal model, and the words x * t of the extension keep their length at least (the differential of a generator has no
+// constant term). The words of length p or more therefore form a subcomplex F^p, and the filtration by word length has
+// a spectral sequence which converges to the homology. The page E_0^p is spanned by the words of length p, d_0 is the
+// part of the differential which keeps the length (it is zero in a minimal model, so E_1 = E_0), d_1 is the quadratic
+// part of the differential, and d_r goes from the words of length p to the words of length p+r.
+//
+// The pages are not built one after the other from the blocks of the length grading: beyond E_1, the differential d_r
+// acts on subquotients whose representatives would have to be found first. Instead, the whole matrix of d_n is
+// assembled, as for "compute = betti", and reduced once, with a reduction which respects the filtration (see
+// ReduceFilteredMatrix in modular.h). Over a field, this reduction pairs some words of X^n with words of X^{n+1}. A pair
+// of words whose lengths differ by r is a class which lives on the pages E_0, ..., E_r and is killed by d_r, and the
+// words left unpaired span E_inf, so the dimensions of every page are read off the pairs. The reduction goes in phases,
+// one per page, and a column paired on page r isn't touched on the later pages.
+// The memory needed is about that of "compute = betti": the matrix of one differential at a time, its reduced columns,
+// and the columns waiting for a later page (see PlanRun in planner.h).
+// Only the dimensions are found, over Q and modulo random primes like the Betti numbers (see modular.h). There is no
+// basis of the pages or of the homology ("compute = extension" gives a basis of the homology).
+class LengthSpectralSequence
+{
+public:
+	// Compute the pages in degrees "degree_start" to "degree_end" of the model /\^{>=minLength}X (+) (/\^{+}X (x) T, with
+	// minLength = category+1 (see ComputeBettiNumbers in main.cpp)
+	void Compute(const FreeCGA &cdga, Differential &diff, int degree_start, int degree_end, int category);
+
+	// The word lengths of the basis in a degree. If the basis is empty, the last length is smaller than the first.
+	int GetMinLength(int degree) const { return GetDegree(degree).min_length; }
+	int GetMaxLength(int degree) const { return GetDegree(degree).min_length + (int)GetDegree(degree).words.size() - 1; }
+	// The index of the first page which is E_inf in a degree. The pages E_0, ..., E_r with r = GetLastPage(degree) are the
+	// ones which can differ.
+	int GetLastPage(int degree) const { return GetDegree(degree).last_page; }
+	// The dimension of E_r^p in a degree, where p is the word length
+	long long GetDimension(int degree, int page, int length) const;
+	// The dimension of the homology in a degree, which is the total dimension of E_inf
+	long long GetHomologyDimension(int degree) const;
+
+private:
+	struct DegreePages
+	{
+		DegreePages() : min_length(0), last_page(0) {}
+
+		int min_length;
+		int last_page;
+		vector<long long> words; // The number of words of each length, from the smallest one
+		vector<vector<long long> > paired; // paired[p][r] is the number of words of the p-th length paired at distance r
+	};
+
+	const DegreePages &GetDegree(int degree) const { return degrees[degree - degree_start]; }
+	// Record a word of the basis in a degree which is paired at distance "distance"
+	void AddPair(int degree, int length, int distance);
+
+	int degree_start;
+	vector<DegreePages> degrees;
+};
+
+#endif